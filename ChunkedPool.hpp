@@ -0,0 +1,218 @@
+#pragma once
+
+/*
+ * A ChunkedPool stores objects in fixed-size chunks, so -- like std::list --
+ *  pointers to elements stay valid as other elements are added and removed,
+ *  but elements are packed together and each has a stable integer index.
+ *
+ * Elements are allocated a chunk at a time and freed all at once (types
+ *  with trivial destructors skip per-element destruction entirely), so big
+ *  pools are much cheaper to build and tear down than lists.
+ *
+ * Indices make it cheap to copy structures that point between elements:
+ *  set() gives a copy the same layout as the original, so a pointer into the
+ *  original can be carried over with translate() (a binary search over
+ *  chunks) instead of a hash table lookup.
+ *
+ * Usage:
+ *  ChunkedPool< Thing > things;
+ *  Thing &thing = things.emplace_back(...);
+ *  uint32_t index = things.index_of(&thing); //things[index] == thing
+ *  things.erase(&thing); //(slot will be reused by a later emplace_back)
+ *  for (Thing &t : things) { ... } //(iterates in index order)
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template< typename T >
+struct ChunkedPool {
+	enum : uint32_t { ChunkSize = 256 }; //elements per chunk
+	enum : uint32_t { NoIndex = -1U };
+
+	ChunkedPool() = default;
+	~ChunkedPool() { clear(); }
+
+	//elements may point to each other, so copying is done explicitly, with set():
+	ChunkedPool(ChunkedPool const &) = delete;
+	ChunkedPool &operator=(ChunkedPool const &) = delete;
+
+	//add an element (reusing a free slot if there is one):
+	template< typename... Args >
+	T &emplace_back(Args&&... args) {
+		uint32_t index;
+		if (!free_slots.empty()) {
+			index = free_slots.back();
+			free_slots.pop_back();
+		} else {
+			if (slots == chunks.size() * ChunkSize) add_chunk();
+			index = slots;
+			slots += 1;
+		}
+		Chunk &chunk = *chunks[index / ChunkSize];
+		T *at = new (chunk.at(index % ChunkSize)) T(std::forward< Args >(args)...);
+		chunk.alive[index % ChunkSize] = true;
+		count += 1;
+		return *at;
+	}
+
+	//remove an element:
+	void erase(T *element) {
+		uint32_t index = index_of(element);
+		assert(index != NoIndex && "erased element is in the pool");
+		Chunk &chunk = *chunks[index / ChunkSize];
+		assert(chunk.alive[index % ChunkSize]);
+		element->~T();
+		chunk.alive[index % ChunkSize] = false;
+		free_slots.emplace_back(index);
+		count -= 1;
+	}
+
+	//remove all elements (chunks are kept for reuse):
+	void clear() {
+		for (uint32_t c = 0; c * ChunkSize < slots; ++c) {
+			Chunk &chunk = *chunks[c];
+			uint32_t end = std::min< uint32_t >(ChunkSize, slots - c * ChunkSize);
+			if constexpr (!std::is_trivially_destructible_v< T >) {
+				for (uint32_t i = 0; i < end; ++i) {
+					if (chunk.alive[i]) chunk.get(i)->~T();
+				}
+			}
+			std::fill(chunk.alive, chunk.alive + end, false);
+		}
+		slots = 0;
+		count = 0;
+		free_slots.clear();
+	}
+
+	//make room for at least 'size' elements without allocating more chunks:
+	void reserve(uint32_t size) {
+		while (chunks.size() * ChunkSize < size) add_chunk();
+	}
+
+	//copy another pool, element-for-element (index i here holds a copy of index i in 'other'):
+	void set(ChunkedPool const &other) {
+		clear();
+		reserve(other.slots);
+		for (uint32_t c = 0; c * ChunkSize < other.slots; ++c) {
+			Chunk const &from = *other.chunks[c];
+			Chunk &to = *chunks[c];
+			uint32_t end = std::min< uint32_t >(ChunkSize, other.slots - c * ChunkSize);
+			if constexpr (std::is_trivially_copyable_v< T >) {
+				//(one copy per chunk; dead slots come along too, but they are never read)
+				std::copy(from.storage, from.storage + end * sizeof(T), to.storage);
+			} else {
+				for (uint32_t i = 0; i < end; ++i) {
+					if (!from.alive[i]) continue;
+					if constexpr (std::is_copy_constructible_v< T >) {
+						new (to.at(i)) T(*from.get(i));
+					} else {
+						//(e.g., Scene::Transform, which can't be copy-constructed but can be assigned)
+						*new (to.at(i)) T() = *from.get(i);
+					}
+				}
+			}
+			std::copy(from.alive, from.alive + end, to.alive);
+		}
+		slots = other.slots;
+		count = other.count;
+		free_slots = other.free_slots;
+	}
+
+	//index of an element, or NoIndex if it isn't in this pool:
+	// (binary search over chunk addresses -- O(log chunks))
+	uint32_t index_of(T const *element) const {
+		if (element == nullptr) return NoIndex;
+		auto f = std::upper_bound(chunk_order.begin(), chunk_order.end(), element, [](T const *e, std::pair< T const *, uint32_t > const &c) {
+			return std::less< T const * >()(e, c.first);
+		});
+		if (f == chunk_order.begin()) return NoIndex;
+		--f;
+		if (!std::less< T const * >()(element, f->first + ChunkSize)) return NoIndex;
+		uint32_t index = f->second * ChunkSize + uint32_t(element - f->first);
+		return (index < slots ? index : NoIndex);
+	}
+
+	//carry a pointer to an element of 'other' over to the matching element of this pool:
+	// (assumes this pool was made from 'other' with set(); null stays null)
+	T *translate(ChunkedPool const &other, T const *element) {
+		if (element == nullptr) return nullptr;
+		uint32_t index = other.index_of(element);
+		assert(index != NoIndex && "translated element is in the other pool");
+		return &(*this)[index];
+	}
+
+	T &operator[](uint32_t index) {
+		assert(index < slots && chunks[index / ChunkSize]->alive[index % ChunkSize]);
+		return *chunks[index / ChunkSize]->get(index % ChunkSize);
+	}
+	T const &operator[](uint32_t index) const {
+		assert(index < slots && chunks[index / ChunkSize]->alive[index % ChunkSize]);
+		return *chunks[index / ChunkSize]->get(index % ChunkSize);
+	}
+
+	uint32_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	uint32_t capacity() const { return uint32_t(chunks.size()) * ChunkSize; }
+
+	//statistics:
+	uint32_t chunk_allocations = 0; //chunks allocated over the pool's lifetime (vs. one allocation per element for a list)
+
+	//iteration (in index order, skipping free slots):
+	template< typename P, typename E >
+	struct Iterator {
+		P *pool = nullptr;
+		uint32_t index = 0;
+		E &operator*() const { return (*pool)[index]; }
+		E *operator->() const { return &(*pool)[index]; }
+		Iterator &operator++() {
+			do { ++index; } while (index < pool->slots && !pool->alive(index));
+			return *this;
+		}
+		bool operator==(Iterator const &o) const { return index == o.index; }
+		bool operator!=(Iterator const &o) const { return index != o.index; }
+	};
+	typedef Iterator< ChunkedPool, T > iterator;
+	typedef Iterator< ChunkedPool const, T const > const_iterator;
+
+	iterator begin() { return iterator{ this, first_alive() }; }
+	iterator end() { return iterator{ this, slots }; }
+	const_iterator begin() const { return const_iterator{ this, first_alive() }; }
+	const_iterator end() const { return const_iterator{ this, slots }; }
+
+	//-- internals ---
+	struct Chunk {
+		alignas(T) unsigned char storage[ChunkSize * sizeof(T)];
+		bool alive[ChunkSize] = { };
+		void *at(uint32_t i) { return storage + i * sizeof(T); }
+		T *get(uint32_t i) { return std::launder(reinterpret_cast< T * >(at(i))); }
+		T const *get(uint32_t i) const { return std::launder(reinterpret_cast< T const * >(storage + i * sizeof(T))); }
+	};
+	std::vector< std::unique_ptr< Chunk > > chunks;
+	std::vector< std::pair< T const *, uint32_t > > chunk_order; //(chunk start, chunk number), sorted by address, for index_of()
+	uint32_t slots = 0; //slots [0,slots) have been handed out at some point
+	uint32_t count = 0; //live elements
+	std::vector< uint32_t > free_slots; //erased slots below 'slots'
+
+	bool alive(uint32_t index) const { return chunks[index / ChunkSize]->alive[index % ChunkSize]; }
+	uint32_t first_alive() const {
+		uint32_t index = 0;
+		while (index < slots && !alive(index)) ++index;
+		return index;
+	}
+	void add_chunk() {
+		chunks.emplace_back(new Chunk); //(n.b. not make_unique, which would zero 'storage' for nothing)
+		chunk_allocations += 1;
+		std::pair< T const *, uint32_t > entry(reinterpret_cast< T const * >(chunks.back()->storage), uint32_t(chunks.size() - 1));
+		chunk_order.insert(std::upper_bound(chunk_order.begin(), chunk_order.end(), entry, [](auto const &a, auto const &b) {
+			return std::less< T const * >()(a.first, b.first);
+		}), entry);
+	}
+};
@@ -2,11 +2,14 @@
 
 #include "gl_compile_program.hpp"
 
+#include <string>
+
 DepthOnlyProgram::DepthOnlyProgram() {
 	program = gl_compile_program(
 		"#version 330\n"
-		"uniform mat4 CLIP_FROM_OBJECT;\n"
+		+ std::string(Scene::ObjectBlockGLSL) +
 		"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
+		"invariant gl_Position;\n" //note: must match exactly between depth pre-pass and shading pass for GL_EQUAL depth testing
 		"in vec3 Normal;\n" //DEBUG
 		"out vec3 color;\n" //DEBUG
 		"void main() {\n"
@@ -22,17 +25,17 @@ DepthOnlyProgram::DepthOnlyProgram() {
 		"}\n"
 	);
 
-	CLIP_FROM_OBJECT_mat4 = glGetUniformLocation(program, "CLIP_FROM_OBJECT");
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Object"), Scene::ObjectBlockBinding);
 }
 
 Load< DepthOnlyProgram > depth_only_program(LoadTagEarly, []() -> DepthOnlyProgram const * {
 	DepthOnlyProgram *ret = new DepthOnlyProgram();
 
-	//set up template pipeline:
-	depth_only_program_pipeline.program = ret->program;
-	depth_only_program_pipeline.CLIP_FROM_OBJECT_mat4 = ret->CLIP_FROM_OBJECT_mat4;
+	//set up template material:
+	depth_only_program_material.program = ret->program;
+	depth_only_program_material.object_block = true;
 
 	return ret;
 });
 
-Scene::Drawable::Pipeline depth_only_program_pipeline;
+Scene::Material depth_only_program_material;
@@ -6,12 +6,12 @@ struct DepthOnlyProgram {
 	//opengl program object:
 	GLuint program = 0;
 
-	//uniform locations:
-	GLuint CLIP_FROM_OBJECT_mat4 = -1U;
+	//uniform blocks:
+	//per-object matrices come from Scene's 'Object' block (see Scene::ObjectBlock)
 
 	DepthOnlyProgram();
 };
 
 extern Load< DepthOnlyProgram > depth_only_program;
 
-extern Scene::Drawable::Pipeline depth_only_program_pipeline;
+extern Scene::Material depth_only_program_material;
@@ -0,0 +1,28 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::update(double gpu_ms) {
+	if (average_ms == 0.0) average_ms = gpu_ms;
+	else average_ms += smoothing * (gpu_ms - average_ms);
+
+	if (settle > 0) {
+		settle -= 1;
+		return;
+	}
+
+	//close enough? leave it alone (avoids visible oscillation):
+	double error = average_ms / target_ms - 1.0;
+	if (std::abs(error) <= deadband) return;
+
+	//GPU time is (mostly) proportional to pixel count, which goes as scale^2:
+	float ideal = scale * float(std::sqrt(target_ms / std::max(average_ms, 0.001)));
+	float stepped = std::clamp(ideal, scale - max_step, scale + max_step);
+	float clamped = std::clamp(stepped, min_scale, max_scale);
+
+	if (clamped != scale) {
+		scale = clamped;
+		settle = settle_frames;
+	}
+}
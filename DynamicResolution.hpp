@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * DynamicResolution picks an internal render scale (fraction of the window
+ *  size along each axis) that keeps measured GPU frame time near a budget.
+ *
+ * Feed it GPU frame times (e.g., from a GPUTimer) and read 'scale'.
+ *
+ * Render targets should be allocated at max_scale and drawn into a
+ *  sub-viewport of (scale * window size), so changing the scale never
+ *  needs to reallocate anything.
+ *
+ */
+
+#include <cstdint>
+
+struct DynamicResolution {
+	//GPU time budget per frame, in milliseconds:
+	// (leave some headroom below the display's frame interval -- e.g., 14ms for 60Hz)
+	float target_ms = 14.0f;
+
+	//range of allowed scales (fraction of window size, along each axis):
+	float min_scale = 0.5f;
+	float max_scale = 1.0f;
+
+	//current scale:
+	float scale = 1.0f;
+
+	//call with each measured GPU frame time:
+	void update(double gpu_ms);
+
+	//tuning:
+	float smoothing = 0.2f; //weight of newest measurement in running average
+	float deadband = 0.1f; //don't adjust while within this fraction of target_ms
+	float max_step = 0.05f; //largest change in scale per adjustment
+	uint32_t settle_frames = 8; //measurements to wait after an adjustment (results lag a few frames)
+
+	//-- internals ---
+	double average_ms = 0.0; //smoothed frame time
+	uint32_t settle = 0; //measurements left to wait before adjusting again
+};
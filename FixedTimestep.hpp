@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ * FixedTimestep turns variable frame times into a whole number of fixed-size
+ *  simulation steps, carrying the remainder over to the next frame.
+ *
+ * Running 'update' only with exactly 'step' seconds makes simulation results
+ *  independent of frame rate (and so reproducible).
+ *
+ * If frames take too long, running enough steps to catch up would make them
+ *  take even longer (the "spiral of death"), so at most 'max_steps' run per
+ *  frame; the time that leaves behind is dropped and tallied in 'dropped'.
+ *
+ */
+
+#include <cstdint>
+#include <cmath>
+
+struct FixedTimestep {
+	double step = 1.0 / 60.0; //seconds per simulation step
+	uint32_t max_steps = 5; //most steps to run in one frame (catch-up budget)
+
+	//add real elapsed seconds; returns number of steps to run now:
+	uint32_t advance(double elapsed) {
+		accumulator += elapsed;
+		double whole = std::floor(accumulator / step);
+		uint32_t steps = (whole > double(max_steps) ? max_steps : uint32_t(whole));
+		if (whole > double(max_steps)) {
+			//over budget -- give up on catching up with the excess:
+			double excess = (whole - double(max_steps)) * step;
+			dropped += excess;
+			dropped_frames += 1;
+			accumulator -= excess;
+		}
+		accumulator -= double(steps) * step;
+		return steps;
+	}
+
+	//fraction of a step accumulated past the last step run, in [0,1):
+	// (useful for interpolating between the previous and current simulation state)
+	float alpha() const {
+		return float(accumulator / step);
+	}
+
+	//start over (e.g., when switching to a new mode):
+	void reset() {
+		accumulator = 0.0;
+	}
+
+	double accumulator = 0.0; //time not yet simulated
+	double dropped = 0.0; //total seconds dropped because of the catch-up budget
+	uint32_t dropped_frames = 0; //frames in which time was dropped
+};
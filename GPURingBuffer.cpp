@@ -0,0 +1,179 @@
+#include "GPURingBuffer.hpp"
+
+#include "gl_errors.hpp"
+#include "gl_extensions.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+GPURingBuffer frame_ring;
+
+void GPURingBuffer::create() {
+	assert(buffer == 0);
+	if (capacity <= 0) throw std::runtime_error("GPURingBuffer capacity must be positive.");
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	uniform_alignment = std::max(alignment, 1);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (gl_ext.buffer_storage) {
+		//immutable storage that stays mapped; coherent, so writes are seen by later commands without explicit flushes:
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		gl_ext.BufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, flags);
+		mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags));
+		persistent = (mapped != nullptr);
+	}
+	if (!persistent) {
+		if (gl_ext.buffer_storage) {
+			//(storage is immutable, so start over with a fresh buffer)
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		}
+		glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		staging.assign(capacity, 0);
+		mapped = staging.data();
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	GL_ERRORS();
+}
+
+void GPURingBuffer::clear() {
+	for (Frame &frame : frames) {
+		glDeleteSync(frame.fence);
+	}
+	frames.clear();
+
+	if (buffer != 0) {
+		if (persistent) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+	persistent = false;
+	mapped = nullptr;
+	staging.clear();
+
+	head = tail = used = flushed = 0;
+	frame_bytes = 0;
+}
+
+void GPURingBuffer::retire_oldest() {
+	assert(!frames.empty());
+	Frame &frame = frames.front();
+
+	GLenum result = glClientWaitSync(frame.fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		//GPU isn't done with it yet, so this is going to be a stall:
+		stalls += 1;
+		do {
+			result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL /* 1s */);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	if (result == GL_WAIT_FAILED) {
+		throw std::runtime_error("GPURingBuffer: waiting on fence failed.");
+	}
+
+	glDeleteSync(frame.fence);
+	tail = frame.end;
+	used -= frame.bytes;
+	frames.pop_front();
+}
+
+GLsizeiptr GPURingBuffer::alignment(Usage usage) {
+	if (buffer == 0) create();
+	if (usage == Uniform) return uniform_alignment;
+	return 16; //(vertex and instance attributes: enough for any single attribute)
+}
+
+GPURingBuffer::Allocation GPURingBuffer::allocate(GLsizeiptr size, Usage usage) {
+	return allocate(size, alignment(usage));
+}
+
+GPURingBuffer::Allocation GPURingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	if (buffer == 0) create();
+	assert(size >= 0);
+	assert(alignment > 0);
+
+	//figure out where the allocation goes -- after head, or at the start of the ring if it doesn't fit at the end:
+	GLsizeiptr offset = (head + alignment - 1) / alignment * alignment;
+	bool wrap = (offset + size > capacity);
+	if (wrap) {
+		offset = 0;
+		//n.b. data in [flushed, head) has to be copied in before the ring wraps past it:
+		flush();
+	}
+	//bytes of the ring this will use up (including padding and anything skipped by wrapping):
+	GLsizeiptr needed = (wrap ? capacity - head : offset - head) + size;
+
+	//make room by waiting for the GPU to finish with old frames:
+	while (capacity - used < needed) {
+		if (frames.empty()) {
+			throw std::runtime_error("GPURingBuffer: a single frame needs more than the capacity of " + std::to_string(capacity) + " bytes.");
+		}
+		retire_oldest();
+	}
+
+	used += needed;
+	frame_bytes += needed;
+	head = offset + size;
+	if (head == capacity) head = 0;
+	if (wrap) flushed = 0;
+
+	Allocation ret;
+	ret.buffer = buffer;
+	ret.offset = offset;
+	ret.size = size;
+	ret.data = mapped + offset;
+	return ret;
+}
+
+void GPURingBuffer::flush() {
+	if (persistent || buffer == 0) return;
+
+	if (flushed == head) return;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	while (flushed != head) {
+		//new data is in [flushed, head), or [flushed, capacity) + [0, head) if head has come back around:
+		GLsizeiptr end = (head < flushed ? capacity : head);
+
+		//unsynchronized is safe because the fences keep allocations from landing on data the GPU is still using:
+		void *dest = glMapBufferRange(GL_COPY_WRITE_BUFFER, flushed, end - flushed, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (dest) {
+			std::memcpy(dest, mapped + flushed, end - flushed);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		} else {
+			glBufferSubData(GL_COPY_WRITE_BUFFER, flushed, end - flushed, mapped + flushed);
+		}
+
+		flushed = (end == capacity ? 0 : end);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GPURingBuffer::end_frame() {
+	last_frame_bytes = frame_bytes;
+	peak_frame_bytes = std::max(peak_frame_bytes, frame_bytes);
+
+	if (frame_bytes != 0) {
+		flush();
+		Frame frame;
+		frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame.end = head;
+		frame.bytes = frame_bytes;
+		frames.emplace_back(frame);
+	}
+
+	frame_bytes = 0;
+}
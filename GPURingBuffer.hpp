@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+ * A GPURingBuffer streams per-frame data (uniform blocks, vertices,
+ *  instance attributes, ...) to the GPU from one large buffer object.
+ *
+ * Each frame's data is sub-allocated from the ring after the previous
+ *  frame's; a fence at the end of each frame says when the GPU is done
+ *  with it, so space is only reused once it is safe to overwrite.
+ *
+ * Usage:
+ *  GPURingBuffer::Allocation a = frame_ring.allocate(sizeof(data), GPURingBuffer::Uniform);
+ *  std::memcpy(a.data, &data, sizeof(data));
+ *  frame_ring.flush(); //before issuing GL commands that use the data
+ *  glBindBufferRange(GL_UNIFORM_BUFFER, binding, a.buffer, a.offset, a.size);
+ *  //...once per frame, after the last command that uses data from the ring:
+ *  frame_ring.end_frame();
+ *
+ * With GL_ARB_buffer_storage, the buffer is persistently mapped and 'data'
+ *  points right into it (so flush() does nothing). Otherwise, 'data' points
+ *  to a CPU-side copy, and flush() copies new data in with an unsynchronized
+ *  mapping (safe, since the fences keep it away from data in use).
+ *
+ */
+
+#include "GL.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct GPURingBuffer {
+	GPURingBuffer() = default;
+
+	//since ring owns OpenGL objects, copying isn't a good idea:
+	GPURingBuffer(GPURingBuffer const &) = delete;
+
+	//total size; set before first allocation:
+	// (should comfortably hold a few frames' worth of data -- see peak_frame_bytes)
+	GLsizeiptr capacity = 8 * 1024 * 1024;
+
+	//what an allocation will be used for (determines its alignment):
+	enum Usage : uint8_t {
+		Uniform, //uniform block data (aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+		Vertex, //vertex attributes
+		Instance, //per-instance attributes
+	};
+
+	struct Allocation {
+		GLuint buffer = 0; //buffer object to bind
+		GLintptr offset = 0; //offset of the allocation in the buffer
+		GLsizeiptr size = 0;
+		void *data = nullptr; //where to write the allocation's contents (valid until end_frame())
+	};
+
+	//alignment of allocations for a given usage:
+	// (useful for laying out several blocks in one allocation)
+	GLsizeiptr alignment(Usage usage);
+
+	//get space for 'size' bytes of data:
+	// (waits on the GPU if the ring is full; throws if a single frame needs more than 'capacity')
+	Allocation allocate(GLsizeiptr size, Usage usage);
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+
+	//make data written to allocations so far visible to GL commands issued after this call:
+	void flush();
+
+	//call once per frame, after all commands using this frame's allocations have been issued:
+	void end_frame();
+
+	//free the buffer and fences:
+	// (n.b. not done in a destructor, since rings often live at global scope and outlive the OpenGL context)
+	void clear();
+
+	//statistics (useful for picking 'capacity'):
+	GLsizeiptr frame_bytes = 0; //bytes (including alignment padding) used so far this frame
+	GLsizeiptr last_frame_bytes = 0; //...in the last complete frame
+	GLsizeiptr peak_frame_bytes = 0; //...in the busiest frame so far
+	uint32_t stalls = 0; //times allocate() had to wait for the GPU to finish with old data
+
+	//-- internals ---
+	GLuint buffer = 0;
+	bool persistent = false; //buffer is persistently mapped (GL_ARB_buffer_storage)
+	uint8_t *mapped = nullptr; //persistent mapping or CPU-side copy of the buffer contents
+	std::vector< uint8_t > staging; //CPU-side copy (when not persistent)
+	GLsizeiptr uniform_alignment = 0;
+
+	//bytes in the ring are in use from 'tail' up to (circularly) 'head':
+	GLsizeiptr head = 0;
+	GLsizeiptr tail = 0;
+	GLsizeiptr used = 0; //bytes between tail and head (so 'head == tail' can mean full or empty)
+	GLsizeiptr flushed = 0; //data from here to head hasn't been flushed yet (when not persistent)
+
+	//earlier frames that may still be in use by the GPU:
+	struct Frame {
+		GLsync fence = 0; //signalled when the GPU is done with the frame
+		GLsizeiptr end = 0; //where head was at end of frame
+		GLsizeiptr bytes = 0; //frame's share of 'used'
+	};
+	std::deque< Frame > frames;
+
+	void create();
+	void retire_oldest(); //wait for the oldest frame and reclaim its space
+};
+
+//ring shared by everything that streams per-frame data:
+// (main loop calls end_frame() after each frame is drawn)
+extern GPURingBuffer frame_ring;
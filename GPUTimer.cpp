@@ -0,0 +1,56 @@
+#include "GPUTimer.hpp"
+
+#include "gl_errors.hpp"
+
+#include <cassert>
+
+void GPUTimer::begin() {
+	assert(!timing && "begin() called twice without end()");
+
+	Slot &slot = slots[next];
+	if (slot.pending) {
+		//oldest measurement still hasn't come back; rather than stall, skip this one:
+		return;
+	}
+	if (slot.queries[0] == 0) {
+		glGenQueries(2, slot.queries);
+	}
+	glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+	timing = true;
+}
+
+void GPUTimer::end() {
+	if (!timing) return; //measurement was skipped in begin()
+
+	Slot &slot = slots[next];
+	glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+	slot.pending = true;
+	timing = false;
+
+	next = (next + 1) % Slots;
+}
+
+bool GPUTimer::poll(double *ms) {
+	assert(ms);
+	bool got = false;
+	//walk slots from oldest to newest so that *ms ends up holding the newest result:
+	for (uint32_t i = 0; i < Slots; ++i) {
+		Slot &slot = slots[(next + i) % Slots];
+		if (!slot.pending) continue;
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		//(begin timestamp was issued earlier, so it is available too)
+		GLuint64 begin_ns = 0, end_ns = 0;
+		glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &begin_ns);
+		glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &end_ns);
+		slot.pending = false;
+
+		*ms = double(end_ns - begin_ns) / 1.0e6;
+		got = true;
+	}
+	GL_ERRORS();
+	return got;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * A GPUTimer measures how long the GPU spends on the commands issued
+ *  between begin() and end(), without ever waiting on the GPU.
+ *
+ * Results arrive a few frames late: call poll() each frame to collect them.
+ *
+ * It uses a pair of GL_TIMESTAMP queries per measurement (rather than
+ *  GL_TIME_ELAPSED), so timed spans may overlap or contain other queries.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <array>
+#include <cstdint>
+
+struct GPUTimer {
+	GPUTimer() = default;
+	//since timer owns OpenGL objects, copying isn't a good idea:
+	GPUTimer(GPUTimer const &) = delete;
+
+	//bracket the commands to time:
+	// (if all query slots are still waiting on results, this measurement is skipped)
+	void begin();
+	void end();
+
+	//collect finished measurements; returns true and sets *ms to the newest if any finished since the last poll:
+	bool poll(double *ms);
+
+	//-- internals ---
+	enum : uint32_t { Slots = 4 }; //measurements that can be in flight at once (roughly: frames of latency)
+	struct Slot {
+		GLuint queries[2] = {0, 0}; //begin, end timestamps
+		bool pending = false; //waiting on results
+	};
+	std::array< Slot, Slots > slots;
+	uint32_t next = 0; //slot to use for the next measurement
+	bool timing = false; //between begin() and end() on a slot
+};
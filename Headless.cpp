@@ -0,0 +1,146 @@
+#include "Headless.hpp"
+
+#include "ShadowMapMode.hpp"
+#include "GL.hpp"
+#include "gl_errors.hpp"
+#include "gl_check_fb.hpp"
+#include "GPURingBuffer.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+//print min / average / percentiles of a list of times:
+static void summarize(std::string const &label, std::vector< double > ms) {
+	if (ms.empty()) {
+		std::cout << "  " << label << ": (no measurements)" << std::endl;
+		return;
+	}
+	std::sort(ms.begin(), ms.end());
+	double total = 0.0;
+	for (double m : ms) total += m;
+	auto percentile = [&ms](double p) {
+		return ms[std::min(ms.size() - 1, size_t(p * double(ms.size())))];
+	};
+	std::cout << "  " << label << ": min " << ms.front() << "ms, avg " << total / double(ms.size()) << "ms, p50 " << percentile(0.5) << "ms, p99 " << percentile(0.99) << "ms, max " << ms.back() << "ms (" << ms.size() << " frames)" << std::endl;
+}
+
+void Headless::run(ShadowMapMode &mode) {
+	//offscreen framebuffer for the final image:
+	// (sRGB, like the window's, so GL_FRAMEBUFFER_SRGB encodes output the same way)
+	GLuint color_rb = 0;
+	glGenRenderbuffers(1, &color_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLuint fb = 0;
+	glGenFramebuffers(1, &fb);
+	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+	gl_check_fb();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GL_ERRORS();
+
+	//make runs repeatable:
+	mode.output_fb = fb;
+	mode.camera_path = true;
+	mode.restart_camera_path(); //(so repeated runs -- e.g., bench's at each scale -- see the same views)
+	mode.dynamic_resolution = false;
+
+	std::vector< uint32_t > dumps = dump_frames;
+	std::sort(dumps.begin(), dumps.end());
+	auto next_dump = dumps.begin();
+
+	cpu_ms.clear();
+	gpu_ms.clear();
+	uint32_t gpu_ms_count = mode.gpu_ms_count;
+
+	if (!trace_filename.empty()) profiler.start_trace();
+
+	std::ofstream stats;
+	if (!stats_filename.empty()) {
+		stats.open(stats_filename, std::ios::binary);
+		if (!stats) throw std::runtime_error("Failed to open '" + stats_filename + "' to write render stats.");
+		stats << "frame,pass,";
+		RenderStats::Counts::write_csv_header(stats);
+		stats << '\n';
+	}
+	RenderStats::Counts stats_total;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < frames; ++frame) {
+		auto before = std::chrono::high_resolution_clock::now();
+		mode.update(elapsed);
+		mode.record(size);
+		mode.flip();
+		mode.draw(size);
+		frame_ring.end_frame();
+		profiler.end_frame();
+		render_stats.end_frame();
+		glFlush(); //(nothing swaps, so make sure the GPU gets to work)
+		auto after = std::chrono::high_resolution_clock::now();
+		cpu_ms.emplace_back(std::chrono::duration< double >(after - before).count() * 1000.0);
+
+		stats_total += render_stats.last_frame;
+		if (stats.is_open()) {
+			auto row = [&](char const *pass, RenderStats::Counts const &counts) {
+				stats << frame << ',' << pass << ',';
+				counts.write_csv(stats);
+				stats << '\n';
+			};
+			row("shadow", mode.shadow_pass_stats);
+			row("scene", mode.scene_pass_stats);
+			row("post", mode.post_pass_stats);
+			row("total", render_stats.last_frame);
+		}
+
+		//(draw polls the GPU timer, so new measurements show up as a changed count)
+		if (mode.gpu_ms_count != gpu_ms_count) {
+			gpu_ms_count = mode.gpu_ms_count;
+			gpu_ms.emplace_back(mode.gpu_ms);
+		}
+
+		while (next_dump != dumps.end() && *next_dump < frame) ++next_dump;
+		if (next_dump != dumps.end() && *next_dump == frame) {
+			std::string filename = dump_prefix + std::to_string(frame) + ".png";
+			std::cout << "Saving frame " << frame << " to '" << filename << "'." << std::endl;
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, fb);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			std::vector< glm::u8vec4 > data(size.x * size.y);
+			glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+			for (auto &px : data) {
+				px.a = 0xff;
+			}
+			save_png(filename, size, data.data(), LowerLeftOrigin);
+		}
+	}
+	glFinish();
+	total_ms = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count() * 1000.0;
+
+	std::cout << "Headless: " << frames << " frames at " << size.x << "x" << size.y << " in " << total_ms << "ms (" << (total_ms > 0.0 ? 1000.0 * frames / total_ms : 0.0) << " fps):" << std::endl;
+	summarize("CPU", cpu_ms);
+	summarize("GPU", gpu_ms);
+	if (frames != 0) {
+		std::cout << "  per frame: " << stats_total.draws / frames << " draws, " << stats_total.vertices / frames << " vertices, "
+			<< stats_total.program_binds / frames << " program / " << stats_total.vao_binds / frames << " VAO / " << stats_total.texture_binds / frames << " texture binds, "
+			<< stats_total.uniform_uploads / frames << " uniform uploads, " << stats_total.buffer_bytes / frames << " buffer bytes" << std::endl;
+	}
+	if (stats.is_open()) std::cout << "Wrote render stats to '" << stats_filename << "'." << std::endl;
+
+	//(one more end_frame picks up GPU spans that finished during glFinish)
+	profiler.end_frame();
+	profiler.print_stats(std::cout);
+	if (!trace_filename.empty()) profiler.stop_trace(trace_filename);
+
+	mode.output_fb = 0;
+	glDeleteFramebuffers(1, &fb);
+	glDeleteRenderbuffers(1, &color_rb);
+	GL_ERRORS();
+}
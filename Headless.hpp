@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * Headless runs ShadowMapMode for a fixed number of frames into an offscreen
+ *  framebuffer -- with the camera following its scripted path and a fixed
+ *  timestep, so runs are repeatable -- and reports how long frames took.
+ *
+ * Selected frames can be saved as PNGs (e.g., for comparing images across
+ *  changes).
+ *
+ * Usage (from main, once an OpenGL context is current and assets are loaded):
+ *  Headless headless;
+ *  headless.frames = 600;
+ *  headless.dump_frames = { 0, 300 };
+ *  headless.run(*mode);
+ *
+ * The window the context belongs to is never shown or swapped, so vsync
+ *  doesn't limit the frame rate.
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShadowMapMode;
+
+struct Headless {
+	//how much to render:
+	uint32_t frames = 600;
+	glm::uvec2 size = glm::uvec2(1280, 720);
+	float elapsed = 1.0f / 60.0f; //simulated seconds per frame
+
+	//frames (numbered from zero) to save as <dump_prefix><frame>.png:
+	std::vector< uint32_t > dump_frames;
+	std::string dump_prefix = "headless-";
+
+	//if not empty, save a profile trace of the whole run here (see Profiler.hpp):
+	std::string trace_filename;
+
+	//if not empty, save per-frame, per-pass render stats here as CSV (see RenderStats.hpp):
+	// (counts don't depend on timing, so files from two builds can be diffed to spot changes in the work a frame does)
+	std::string stats_filename;
+
+	//render the frames, then print a timing summary (and profiler stats) to std::cout:
+	void run(ShadowMapMode &mode);
+
+	//per-frame results from the last run:
+	std::vector< double > cpu_ms; //update + record + draw (submission only)
+	std::vector< double > gpu_ms; //as measured by the mode (these lag a few frames, so may be fewer)
+	double total_ms = 0.0; //wall time for all frames, including waiting for the GPU to finish
+};
@@ -0,0 +1,97 @@
+#include "InternedString.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace {
+	struct Table {
+		std::mutex mutex;
+		std::deque< std::string > strings; //id -> text (deque, so references stay valid as it grows)
+
+		//text -> id lookup, as an open-addressed hash table of (hash, id) pairs:
+		// (text is compared against 'strings', so there is no per-string allocation beyond the string itself)
+		struct Slot {
+			uint32_t hash = 0;
+			uint32_t id = InternedString::Missing;
+		};
+		std::vector< Slot > slots; //size is a power of two, kept at most half full
+
+		static uint32_t hash(std::string_view text) {
+			size_t h = std::hash< std::string_view >()(text);
+			return uint32_t(h ^ (uint64_t(h) >> 32));
+		}
+
+		//slot holding 'text', or the empty slot where it would go:
+		Slot &find(std::string_view text, uint32_t h) {
+			uint32_t mask = uint32_t(slots.size() - 1);
+			uint32_t i = h & mask;
+			while (slots[i].id != InternedString::Missing && !(slots[i].hash == h && strings[slots[i].id] == text)) {
+				i = (i + 1) & mask;
+			}
+			return slots[i];
+		}
+
+		uint32_t add(std::string_view text, uint32_t h) {
+			if (2 * (strings.size() + 1) > slots.size()) {
+				std::vector< Slot > old = std::move(slots);
+				slots.assign(std::max< size_t >(1024, old.size() * 2), Slot());
+				uint32_t mask = uint32_t(slots.size() - 1);
+				for (Slot const &o : old) {
+					if (o.id == InternedString::Missing) continue;
+					uint32_t i = o.hash & mask;
+					while (slots[i].id != InternedString::Missing) i = (i + 1) & mask;
+					slots[i] = o;
+				}
+			}
+			Slot &slot = find(text, h);
+			assert(slot.id == InternedString::Missing);
+			slot.hash = h;
+			slot.id = uint32_t(strings.size());
+			strings.emplace_back(text);
+			return slot.id;
+		}
+
+		Table() {
+			add(std::string_view(), hash(std::string_view()));
+			assert(strings.size() == 1); //(so "" has id Empty)
+		}
+	};
+	//(function-local static, so it is ready for interning done during static initialization)
+	Table &get_table() {
+		static Table table;
+		return table;
+	}
+}
+
+InternedString::InternedString(std::string_view text) {
+	Table &table = get_table();
+	uint32_t h = Table::hash(text);
+	std::unique_lock< std::mutex > lock(table.mutex);
+	Table::Slot const &slot = table.find(text, h);
+	id = (slot.id != Missing ? slot.id : table.add(text, h));
+}
+
+InternedString InternedString::find(std::string_view text) {
+	Table &table = get_table();
+	InternedString ret;
+	uint32_t h = Table::hash(text);
+	std::unique_lock< std::mutex > lock(table.mutex);
+	ret.id = table.find(text, h).id;
+	return ret;
+}
+
+std::string const &InternedString::str() const {
+	Table &table = get_table();
+	std::unique_lock< std::mutex > lock(table.mutex);
+	assert(id < table.strings.size() && "InternedString has a valid id");
+	return table.strings[id];
+}
+
+uint32_t InternedString::count() {
+	Table &table = get_table();
+	std::unique_lock< std::mutex > lock(table.mutex);
+	return uint32_t(table.strings.size());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * An InternedString refers to a string stored (once) in a global table by
+ *  a compact id, so copying, comparing, and hashing them is just copying,
+ *  comparing, and hashing integers.
+ *
+ * Usage:
+ *  InternedString name("Platform"); //adds "Platform" to the table if needed
+ *  if (transform->name == name) { ... }
+ *  std::cout << name.str() << std::endl;
+ *
+ *  //loaders intern names straight out of a file's 'str0' chunk:
+ *  InternedString n(std::string_view(str0.data() + begin, end - begin));
+ *
+ *  //to look up text without adding it to the table:
+ *  InternedString q = InternedString::find("Platform"); //(matches nothing if never interned)
+ *
+ * The table is shared by all threads (access is guarded by a mutex), and
+ *  strings stay in it until the program exits.
+ *
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+struct InternedString {
+	enum : uint32_t {
+		Empty = 0, //id of ""
+		Missing = -1U, //id returned by find() for text that was never interned
+	};
+	uint32_t id = Empty;
+
+	InternedString() = default;
+	explicit InternedString(std::string_view text); //(interns 'text')
+
+	//interned string for 'text' if it is in the table, otherwise one with id Missing:
+	static InternedString find(std::string_view text);
+
+	//the text itself:
+	// (reference is good until program exit; n.b. Missing ids have no text)
+	std::string const &str() const;
+
+	bool empty() const { return id == Empty; }
+	bool operator==(InternedString const &o) const { return id == o.id; }
+	bool operator!=(InternedString const &o) const { return id != o.id; }
+	//comparing with text doesn't intern it:
+	bool operator==(std::string_view text) const { return id != Missing && str() == text; }
+	bool operator!=(std::string_view text) const { return !(*this == text); }
+
+	//number of strings interned so far:
+	static uint32_t count();
+};
+
+template< >
+struct std::hash< InternedString > {
+	size_t operator()(InternedString const &s) const { return std::hash< uint32_t >()(s.id); }
+};
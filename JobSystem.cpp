@@ -0,0 +1,117 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+uint32_t JobSystem::default_workers() {
+	uint32_t cores = std::thread::hardware_concurrency();
+	return (cores > 1 ? cores - 1 : 0);
+}
+
+JobSystem &JobSystem::shared() {
+	static JobSystem jobs;
+	return jobs;
+}
+
+JobSystem::JobSystem(uint32_t count) {
+	workers.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		workers.emplace_back([this](){
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				job_queued.wait(lock, [this](){ return quit || !queue.empty(); });
+				if (quit) break;
+
+				Job job = std::move(queue.front());
+				queue.pop_front();
+
+				lock.unlock();
+				job.fn();
+				finish(job);
+				lock.lock();
+			}
+		});
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	job_queued.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void JobSystem::run(Group *group, std::function< void() > &&fn) {
+	assert(group);
+	group->pending += 1;
+
+	//no workers? just run it here:
+	if (workers.empty()) {
+		fn();
+		group->pending -= 1;
+		return;
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		queue.emplace_back(Job{ group, std::move(fn) });
+	}
+	job_queued.notify_one();
+}
+
+bool JobSystem::run_one() {
+	Job job;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		if (queue.empty()) return false;
+		job = std::move(queue.front());
+		queue.pop_front();
+	}
+	job.fn();
+	finish(job);
+	return true;
+}
+
+void JobSystem::finish(Job const &job) {
+	{
+		//(decrement under the lock so a waiter can't miss the notification)
+		std::unique_lock< std::mutex > lock(mutex);
+		job.group->pending -= 1;
+	}
+	job_finished.notify_all();
+}
+
+void JobSystem::wait(Group *group) {
+	assert(group);
+	while (group->pending != 0) {
+		//help out with queued jobs (which might be the ones being waited on):
+		if (run_one()) continue;
+
+		//nothing left to help with, so wait for other threads to finish up:
+		std::unique_lock< std::mutex > lock(mutex);
+		job_finished.wait(lock, [&](){ return group->pending == 0 || !queue.empty(); });
+	}
+}
+
+void JobSystem::parallel_for(uint32_t count, uint32_t chunk, std::function< void(uint32_t begin, uint32_t end) > const &fn) {
+	chunk = std::max(chunk, 1U);
+
+	//not worth handing out? do it here:
+	if (count <= chunk || workers.empty()) {
+		if (count > 0) fn(0, count);
+		return;
+	}
+
+	Group group;
+	//queue all chunks but the first, which the calling thread does itself:
+	for (uint32_t begin = chunk; begin < count; begin += chunk) {
+		uint32_t end = std::min(count, begin + chunk);
+		run(&group, [&fn, begin, end](){ fn(begin, end); });
+	}
+	fn(0, chunk);
+	wait(&group);
+}
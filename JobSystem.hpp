@@ -0,0 +1,77 @@
+#pragma once
+
+/*
+ * A JobSystem runs small CPU-only jobs on a fixed pool of worker threads.
+ *
+ * Usage:
+ *  JobSystem::Group group;
+ *  jobs.run(&group, [&](){ ... });
+ *  jobs.run(&group, [&](){ ... });
+ *  jobs.wait(&group); //both jobs are done after this returns
+ *
+ *  //or, to split a loop into chunks:
+ *  jobs.parallel_for(count, 64, [&](uint32_t begin, uint32_t end){ ... });
+ *
+ * Threads that wait on a group run queued jobs while they wait, so jobs may
+ *  themselves run and wait on other jobs (e.g., parallel_for inside a job).
+ *
+ * Jobs must not throw, and must not make GL calls.
+ *
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobSystem {
+	//start 'workers' threads: (by default, one per core, less one for the calling thread)
+	explicit JobSystem(uint32_t workers = default_workers());
+	~JobSystem();
+
+	//since the job system owns threads, copying isn't a good idea:
+	JobSystem(JobSystem const &) = delete;
+
+	//jobs are run as part of a group, which can be waited on:
+	struct Group {
+		std::atomic< uint32_t > pending = 0; //jobs in the group that haven't finished
+	};
+
+	//queue a job:
+	void run(Group *group, std::function< void() > &&job);
+
+	//return once all jobs in the group are done (running other queued jobs while waiting):
+	void wait(Group *group);
+
+	//call fn(begin, end) on chunks of (at most) 'chunk' items that together cover [0, count), then return:
+	// (small loops are run directly on the calling thread)
+	void parallel_for(uint32_t count, uint32_t chunk, std::function< void(uint32_t begin, uint32_t end) > const &fn);
+
+	uint32_t worker_count() const { return uint32_t(workers.size()); }
+
+	static uint32_t default_workers();
+
+	//job system shared by the whole program (started on first use):
+	static JobSystem &shared();
+
+	//-- internals ---
+	struct Job {
+		Group *group = nullptr;
+		std::function< void() > fn;
+	};
+	//pop and run a queued job (if any); returns false if the queue was empty:
+	bool run_one();
+	void finish(Job const &job);
+
+	std::mutex mutex; //guards everything below
+	std::condition_variable job_queued; //signalled when a job is queued (or on shutdown)
+	std::condition_variable job_finished; //signalled when a job finishes
+	std::deque< Job > queue;
+	bool quit = false;
+
+	std::vector< std::thread > workers;
+};
@@ -1,5 +1,7 @@
 #include "Load.hpp"
 
+#include "Profiler.hpp"
+
 #include <array>
 #include <list>
 #include <cassert>
@@ -22,6 +24,8 @@ void call_load_functions() {
 	assert(!has_been_called && "call_load_functions should only be called *once*");
 	has_been_called = true;
 
+	ProfileScope scope("call_load_functions");
+
 	auto &load_lists = get_load_lists();
 	for (auto &fn_list : load_lists) {
 		while (!fn_list.empty()) {
@@ -117,18 +117,34 @@ if (maek.OS === 'windows') {
 const game_names = [
 	maek.CPP('ShadowedColorTextureProgram.cpp'),
 	maek.CPP('DepthOnlyProgram.cpp'),
+	maek.CPP('PostProcessPrograms.cpp'),
+	maek.CPP('RenderTargetPool.cpp'),
+	maek.CPP('DynamicResolution.cpp'),
+	maek.CPP('GPUTimer.cpp'),
 	maek.CPP('ShadowMapMode.cpp'),
-	maek.CPP('main.cpp'),
+	maek.CPP('Headless.cpp'),
 ];
 
+//(also used by the standalone tools below)
+const job_system_obj = maek.CPP('JobSystem.cpp');
+const read_write_chunk_obj = maek.CPP('read_write_chunk.cpp');
+
 const common_names = [
 	maek.CPP('data_path.cpp'),
 	maek.CPP('Scene.cpp'),
 	maek.CPP('Mesh.cpp'),
+	maek.CPP('StaticBatcher.cpp'),
 	maek.CPP('load_save_png.cpp'),
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
 	maek.CPP('GL.cpp'),
+	maek.CPP('gl_extensions.cpp'),
+	job_system_obj,
+	read_write_chunk_obj,
+	maek.CPP('GPURingBuffer.cpp'),
+	maek.CPP('InternedString.cpp'),
+	maek.CPP('Profiler.cpp'),
+	maek.CPP('RenderStats.cpp'),
 	maek.CPP('Load.cpp')
 ];
 
@@ -136,10 +152,27 @@ const common_names = [
 // objFiles: array of objects to link
 // exeFileBase: name of executable file to produce
 //returns exeFile: exeFileBase + a platform-dependant suffix (e.g., '.exe' on windows)
-const game_exe = maek.LINK([...game_names, ...common_names], 'dist/game');
+const game_exe = maek.LINK([maek.CPP('main.cpp'), ...game_names, ...common_names], 'dist/game');
+
+//benchmark for scene building, copying, and teardown (see bench-scene.cpp):
+const bench_scene_exe = maek.LINK([maek.CPP('bench-scene.cpp'), ...common_names], 'dist/bench-scene');
+
+//benchmark suite -- microbenchmarks plus headless rendering, at several scales -- (see bench.cpp):
+// (build just this with 'node Maekfile.js dist/bench')
+const bench_exe = maek.LINK([maek.CPP('bench.cpp'), ...game_names, ...common_names], 'dist/bench');
+
+//procedural scene generator, for making big test scenes (see generate-scene.cpp):
+// (only needs Mesh.hpp's vertex layout and chunk writing, so links little else)
+const generate_scene_exe = maek.LINK([maek.CPP('generate-scene.cpp'), read_write_chunk_obj, job_system_obj], 'dist/generate-scene');
+
+//OBJ to .pnct + .scene converter -- a Blender-free alternative to scenes/export-*.py -- (see convert-obj.cpp):
+const convert_obj_exe = maek.LINK([maek.CPP('convert-obj.cpp'), read_write_chunk_obj, job_system_obj], 'dist/convert-obj');
+
+//level-of-detail generator, adding simplified '<name>@lod<n>' meshes to .pnct files (see simplify-mesh.cpp):
+const simplify_mesh_exe = maek.LINK([maek.CPP('simplify-mesh.cpp'), read_write_chunk_obj, job_system_obj], 'dist/simplify-mesh');
 
-//set the default target to the game (and copy the readme files):
-maek.TARGETS = [game_exe, ...copies];
+//set the default target to the game, benchmarks, and tools (and copy the readme files):
+maek.TARGETS = [game_exe, bench_scene_exe, bench_exe, generate_scene_exe, convert_obj_exe, simplify_mesh_exe, ...copies];
 
 //Note that tasks that produce ':abstract targets' are never cached.
 // This is similar to how .PHONY targets behave in make.
@@ -1,5 +1,8 @@
 #include "Mesh.hpp"
 #include "read_write_chunk.hpp"
+#include "file_entries.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
 
 #include <glm/glm.hpp>
 
@@ -10,39 +13,184 @@
 #include <string>
 #include <set>
 #include <cstddef>
+#include <cassert>
+#include <cmath>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESH_BOUNDS_SSE2 //(x86 compilers that target SSE2 -- i.e., all 64-bit ones)
+#endif
 
-	std::ifstream file(filename, std::ios::binary);
+void MeshBuffer::upload(std::vector< Vertex > const &data) {
+	if (buffer == 0) glGenBuffers(1, &buffer);
+
+	//upload data:
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	GLuint total = 0;
+	total = GLuint(data.size()); //store total for later checks on index
+
+	//store attrib locations:
+	Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+	Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
+	Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+	TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+}
+
+MeshBuffer::MeshBuffer(std::vector< Vertex > const &data) {
+	upload(data);
+}
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-		glm::vec2 TexCoord;
+//bounds kernels, over a range of vertices:
+// (SSE2 versions load each position as four floats -- the fourth is Normal.x, which is ignored; elsewhere, plain loops)
+namespace {
+	//min and max of positions in [begin, end); 'finite' is set to whether they were all finite:
+	void bounds_kernel(MeshBuffer::Vertex const *begin, MeshBuffer::Vertex const *end, glm::vec3 *min, glm::vec3 *max, bool *finite) {
+#ifdef MESH_BOUNDS_SSE2
+		//(two sets of accumulators, to overlap dependent min/max chains)
+		__m128 min0 = _mm_set1_ps( std::numeric_limits< float >::infinity()), min1 = min0;
+		__m128 max0 = _mm_set1_ps(-std::numeric_limits< float >::infinity()), max1 = max0;
+		__m128 bad = _mm_setzero_ps(); //(p - p is zero for finite p, NaN otherwise; so this stays zero if all are finite)
+		MeshBuffer::Vertex const *v = begin;
+		for (; v + 2 <= end; v += 2) {
+			__m128 a = _mm_loadu_ps(&v[0].Position.x);
+			__m128 b = _mm_loadu_ps(&v[1].Position.x);
+			min0 = _mm_min_ps(min0, a); max0 = _mm_max_ps(max0, a);
+			min1 = _mm_min_ps(min1, b); max1 = _mm_max_ps(max1, b);
+			bad = _mm_add_ps(bad, _mm_add_ps(_mm_sub_ps(a, a), _mm_sub_ps(b, b)));
+		}
+		if (v < end) {
+			__m128 a = _mm_loadu_ps(&v[0].Position.x);
+			min0 = _mm_min_ps(min0, a); max0 = _mm_max_ps(max0, a);
+			bad = _mm_add_ps(bad, _mm_sub_ps(a, a));
+		}
+		float mn[4], mx[4], b[4];
+		_mm_storeu_ps(mn, _mm_min_ps(min0, min1));
+		_mm_storeu_ps(mx, _mm_max_ps(max0, max1));
+		_mm_storeu_ps(b, bad);
+		*min = glm::vec3(mn[0], mn[1], mn[2]);
+		*max = glm::vec3(mx[0], mx[1], mx[2]);
+		*finite = (b[0] == 0.0f && b[1] == 0.0f && b[2] == 0.0f);
+#else
+		glm::vec3 mn = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 mx = glm::vec3(-std::numeric_limits< float >::infinity());
+		glm::vec3 bad = glm::vec3(0.0f);
+		for (MeshBuffer::Vertex const *v = begin; v < end; ++v) {
+			mn = glm::min(mn, v->Position);
+			mx = glm::max(mx, v->Position);
+			bad += v->Position - v->Position;
+		}
+		*min = mn;
+		*max = mx;
+		*finite = (bad == glm::vec3(0.0f));
+#endif
+	}
+
+	//largest squared distance from 'center' to positions in [begin, end):
+	float radius2_kernel(MeshBuffer::Vertex const *begin, MeshBuffer::Vertex const *end, glm::vec3 center) {
+		float ret = 0.0f;
+		MeshBuffer::Vertex const *v = begin;
+#ifdef MESH_BOUNDS_SSE2
+		//four vertices at a time, transposed so x, y, and z are each in their own register:
+		__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		__m128 best = _mm_setzero_ps();
+		for (; v + 4 <= end; v += 4) {
+			__m128 x = _mm_loadu_ps(&v[0].Position.x);
+			__m128 y = _mm_loadu_ps(&v[1].Position.x);
+			__m128 z = _mm_loadu_ps(&v[2].Position.x);
+			__m128 w = _mm_loadu_ps(&v[3].Position.x);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			__m128 dx = _mm_sub_ps(x, cx), dy = _mm_sub_ps(y, cy), dz = _mm_sub_ps(z, cz);
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			best = _mm_max_ps(best, d2);
+		}
+		float b[4];
+		_mm_storeu_ps(b, best);
+		ret = std::max(std::max(b[0], b[1]), std::max(b[2], b[3]));
+#endif
+		for (; v < end; ++v) {
+			glm::vec3 d = v->Position - center;
+			ret = std::max(ret, glm::dot(d, d));
+		}
+		return ret;
+	}
+}
+
+void MeshBuffer::compute_bounds(std::vector< Vertex > const &data, Mesh *mesh) {
+	assert(mesh);
+	compute_bounds(data, std::vector< Mesh * >{ mesh });
+}
+
+void MeshBuffer::compute_bounds(std::vector< Vertex > const &data, std::vector< Mesh * > const &meshes, std::vector< bool > *finite) {
+	//meshes are split into pieces of at most PieceSize vertices, so big meshes are spread over threads too:
+	constexpr uint32_t PieceSize = 1 << 15;
+	struct Piece {
+		uint32_t mesh;
+		uint32_t begin, end;
+		glm::vec3 min, max;
+		bool finite;
+		float radius2;
 	};
-	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+	std::vector< Piece > pieces;
+	for (uint32_t m = 0; m < meshes.size(); ++m) {
+		Mesh const &mesh = *meshes[m];
+		assert(mesh.start + mesh.count <= data.size());
+		for (uint32_t begin = mesh.start; begin < mesh.start + mesh.count; begin += PieceSize) {
+			pieces.emplace_back(Piece{ m, begin, std::min(begin + PieceSize, mesh.start + mesh.count), glm::vec3(0.0f), glm::vec3(0.0f), true, 0.0f });
+		}
+	}
+
+	JobSystem &jobs = JobSystem::shared();
+
+	//boxes:
+	jobs.parallel_for(uint32_t(pieces.size()), 4, [&](uint32_t begin, uint32_t end){
+		for (uint32_t p = begin; p < end; ++p) {
+			Piece &piece = pieces[p];
+			bounds_kernel(data.data() + piece.begin, data.data() + piece.end, &piece.min, &piece.max, &piece.finite);
+		}
+	});
+	if (finite) finite->assign(meshes.size(), true);
+	for (Mesh *mesh : meshes) {
+		mesh->min = glm::vec3( std::numeric_limits< float >::infinity());
+		mesh->max = glm::vec3(-std::numeric_limits< float >::infinity());
+		mesh->triangles = (mesh->type == GL_TRIANGLES ? mesh->count / 3 : 0);
+	}
+	for (Piece const &piece : pieces) {
+		Mesh &mesh = *meshes[piece.mesh];
+		mesh.min = glm::min(mesh.min, piece.min);
+		mesh.max = glm::max(mesh.max, piece.max);
+		if (finite && !piece.finite) (*finite)[piece.mesh] = false;
+	}
+	for (Mesh *mesh : meshes) {
+		mesh->center = (mesh->count ? 0.5f * (mesh->min + mesh->max) : glm::vec3(0.0f));
+	}
+
+	//spheres (around the boxes' centers):
+	jobs.parallel_for(uint32_t(pieces.size()), 4, [&](uint32_t begin, uint32_t end){
+		for (uint32_t p = begin; p < end; ++p) {
+			Piece &piece = pieces[p];
+			piece.radius2 = radius2_kernel(data.data() + piece.begin, data.data() + piece.end, meshes[piece.mesh]->center);
+		}
+	});
+	for (Mesh *mesh : meshes) mesh->radius = 0.0f;
+	for (Piece const &piece : pieces) {
+		Mesh &mesh = *meshes[piece.mesh];
+		mesh.radius = std::max(mesh.radius, std::sqrt(piece.radius2));
+	}
+}
+
+MeshBuffer::MeshBuffer(std::string const &filename, bool keep_vertices) {
+	ProfileScope scope("MeshBuffer load");
+
+	std::ifstream file(filename, std::ios::binary);
+
 	std::vector< Vertex > data;
 
 	//read + upload data chunk:
 	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
 		read_chunk(file, "pnct", &data);
-
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		total = GLuint(data.size()); //store total for later checks on index
-
-		//store attrib locations:
-		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
-		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
-		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
-		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+		upload(data);
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
@@ -51,15 +199,11 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 	read_chunk(file, "str0", &strings);
 
 	{ //read index chunk, add to meshes:
-		struct IndexEntry {
-			uint32_t name_begin, name_end;
-			uint32_t vertex_begin, vertex_end;
-		};
-		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
-
 		std::vector< IndexEntry > index;
 		read_chunk(file, "idx0", &index);
 
+		std::vector< std::pair< InternedString, Mesh > > loaded;
+		loaded.reserve(index.size());
 		for (auto const &entry : index) {
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
@@ -67,18 +211,73 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			InternedString name(std::string_view(strings.data() + entry.name_begin, entry.name_end - entry.name_begin));
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
-			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
-				mesh.min = glm::min(mesh.min, data[v].Position);
-				mesh.max = glm::max(mesh.max, data[v].Position);
+			loaded.emplace_back(name, mesh);
+		}
+
+		//compute bounds (for all meshes at once, so they can be done in parallel):
+		std::vector< Mesh * > to_bound;
+		to_bound.reserve(loaded.size());
+		for (auto &[name, mesh] : loaded) to_bound.emplace_back(&mesh);
+		std::vector< bool > finite;
+		{
+			ProfileScope bounds_scope("MeshBuffer bounds");
+			compute_bounds(data, to_bound, &finite);
+		}
+
+		for (uint32_t i = 0; i < loaded.size(); ++i) {
+			auto const &[name, mesh] = loaded[i];
+			if (mesh.count % 3 != 0) {
+				std::cerr << "WARNING: mesh '" + name.str() + "' in filename '" + filename + "' has " << mesh.count << " vertices, which is not a whole number of triangles." << std::endl;
+			}
+			if (!finite[i]) {
+				std::cerr << "WARNING: mesh '" + name.str() + "' in filename '" + filename + "' has non-finite vertex positions." << std::endl;
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
+			bool inserted = meshes.insert(loaded[i]).second;
 			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+				std::cerr << "WARNING: mesh name '" + name.str() + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+			}
+		}
+
+		//attach "<name>@lod<n>" meshes to "<name>" as levels of detail:
+		for (auto const &[name, mesh] : loaded) {
+			std::string_view str = name.str();
+			size_t at = str.rfind("@lod");
+			if (at == std::string_view::npos) continue;
+			uint32_t level = 0;
+			for (char c : str.substr(at + 4)) {
+				if (c < '0' || c > '9') { level = 0; break; }
+				level = std::min(level * 10 + uint32_t(c - '0'), 1000U);
+			}
+			if (level == 0) continue; //(not a level-of-detail name after all)
+
+			InternedString base = InternedString::find(str.substr(0, at));
+			auto f = meshes.find(base);
+			if (base.id == InternedString::Missing || f == meshes.end()) {
+				std::cerr << "WARNING: level-of-detail mesh '" + name.str() + "' in filename '" + filename + "' has no base mesh." << std::endl;
+				continue;
+			}
+			if (level > Mesh::MaxLODs) {
+				std::cerr << "WARNING: ignoring level-of-detail mesh '" + name.str() + "' in filename '" + filename + "' (at most " << Mesh::MaxLODs << " levels are supported)." << std::endl;
+				continue;
+			}
+			Mesh &full = f->second;
+			full.lods[level-1].start = mesh.start;
+			full.lods[level-1].count = mesh.count;
+			full.lod_count = std::max(full.lod_count, level);
+		}
+		//(levels must be contiguous)
+		for (auto &[name, mesh] : meshes) {
+			for (uint32_t l = 0; l < mesh.lod_count; ++l) {
+				if (mesh.lods[l].count == 0) {
+					std::cerr << "WARNING: mesh '" + name.str() + "' in filename '" + filename + "' is missing level of detail " << (l+1) << "; using only the levels before it." << std::endl;
+					mesh.lod_count = l;
+					break;
+				}
 			}
 		}
 	}
@@ -87,25 +286,37 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
+	if (keep_vertices) vertices = std::move(data);
+
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
+	uint32_t printed = 0;
 	for (auto const &m : meshes) {
-		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
-		std::cout << " '" << m.first << "'";
-		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+		printed += 1;
+		if (printed == meshes.size() && meshes.size() > 1) std::cout << " and";
+		std::cout << " '" << m.first.str() << "'";
+		if (printed != meshes.size()) std::cout << ",";
 	}
 	std::cout << std::endl;
 	*/
 }
 
-const Mesh &MeshBuffer::lookup(std::string const &name) const {
+const Mesh &MeshBuffer::lookup(InternedString name) const {
 	auto f = meshes.find(name);
 	if (f == meshes.end()) {
-		throw std::runtime_error("Looking up mesh '" + name + "' that doesn't exist.");
+		throw std::runtime_error("Looking up mesh '" + (name.id == InternedString::Missing ? std::string("(never interned)") : name.str()) + "' that doesn't exist.");
 	}
 	return f->second;
 }
 
+const Mesh &MeshBuffer::lookup(std::string_view name) const {
+	InternedString interned = InternedString::find(name);
+	if (interned.id == InternedString::Missing) {
+		throw std::runtime_error("Looking up mesh '" + std::string(name) + "' that doesn't exist.");
+	}
+	return lookup(interned);
+}
+
 GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 	//create a new vertex array object:
 	GLuint vao = 0;
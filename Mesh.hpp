@@ -5,15 +5,20 @@
  *  the OpenGL pipeline together.
  * A "MeshBuffer" holds a collection of such meshes (loaded from a file) in
  *  a single OpenGL array buffer. Individual meshes can be looked up by name
- *  using the MeshBuffer::lookup() function.
+ *  (interned, see InternedString.hpp) using the MeshBuffer::lookup() function.
+ *
+ * Meshes named "name@lod1", "name@lod2", ... (as written by simplify-mesh.cpp)
+ *  are also attached to mesh "name" as coarser levels of detail (Mesh::lods).
  *
  */
 
 #include "GL.hpp"
+#include "InternedString.hpp"
 #include <glm/glm.hpp>
-#include <map>
 #include <limits>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 
 struct Mesh {
@@ -27,16 +32,46 @@ struct Mesh {
 	//useful for debug visualization and (perhaps, eventually) collision detection:
 	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
 	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+	//Bounding sphere (around the bounding box's center) and triangle count:
+	// (for culling and level-of-detail decisions)
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+	uint32_t triangles = 0;
+
+	//Coarser levels of detail, from meshes named "<name>@lod1", "<name>@lod2", ...:
+	// (set when the MeshBuffer is loaded; lods[0] is lod1)
+	enum : uint32_t { MaxLODs = 3 };
+	uint32_t lod_count = 0;
+	struct LOD {
+		GLuint start = 0;
+		GLuint count = 0;
+	} lods[MaxLODs];
 };
 
 struct MeshBuffer {
+	//Vertex format stored in the buffer:
+	struct Vertex {
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
 	//construct from a file:
 	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	// if 'keep_vertices' is set, a CPU-side copy of the vertices is kept in 'vertices' (e.g., for StaticBatcher)
+	MeshBuffer(std::string const &filename, bool keep_vertices = false);
+
+	//construct from vertices already in memory:
+	// (no meshes are defined; add them to 'meshes' as needed)
+	MeshBuffer(std::vector< Vertex > const &vertices);
 
 	//look up a particular mesh by name:
 	// note: will throw if mesh not found.
-	const Mesh &lookup(std::string const &name) const;
+	const Mesh &lookup(InternedString name) const;
+	const Mesh &lookup(std::string_view name) const; //(looks up the name without interning it)
 	
 	//build a vertex array object that links this vbo to attributes to a program:
 	// note: will throw if program defines attributes not contained in this buffer
@@ -48,7 +83,20 @@ struct MeshBuffer {
 	//-- internals ---
 
 	//used by the lookup() function:
-	std::map< std::string, Mesh > meshes;
+	std::unordered_map< InternedString, Mesh > meshes;
+
+	//CPU-side copy of the vertices in 'buffer' (if requested when loading):
+	std::vector< Vertex > vertices;
+	GLuint total = 0; //number of vertices in 'buffer'
+
+	//upload vertices to 'buffer' and set up attribs:
+	void upload(std::vector< Vertex > const &data);
+
+	//set a mesh's bounding box, bounding sphere, and triangle count from the vertices in its range:
+	static void compute_bounds(std::vector< Vertex > const &data, Mesh *mesh);
+	//...or several meshes' at once (in parallel, with SIMD where available):
+	// if 'finite' is given, (*finite)[i] is set to whether all of meshes[i]'s positions are finite
+	static void compute_bounds(std::vector< Vertex > const &data, std::vector< Mesh * > const &meshes, std::vector< bool > *finite = nullptr);
 
 	//These 'Attrib' structures describe the location of various attributes within the buffer (in exactly format wanted by glVertexAttribPointer). They are set when the file is loaded and are used by the "make_vao_for_program" call:
 	struct Attrib {
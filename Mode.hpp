@@ -20,6 +20,26 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//pipelined drawing support:
+	// each frame, 'record' is called after 'update' and 'flip' is called just before 'draw'.
+	// A mode can do all of its scene traversal in 'record' (saving the results in a back buffer),
+	// swap buffers in 'flip', and have 'draw' use only the front buffer to make GL calls.
+	//If such a mode returns 'true' from 'can_pipeline', the main loop may run
+	// 'update' + 'record' for the next frame on another thread while 'draw' runs.
+	// ('handle_event' and 'flip' are always called while no other mode function is running)
+	virtual void record(glm::uvec2 const &drawable_size) { }
+	virtual void flip() { }
+	virtual bool can_pipeline() const { return false; }
+
+	//fixed timestep support:
+	// if 'fixed_timestep' is nonzero, 'update' is always called with exactly that 'elapsed' time,
+	// as many times per frame as needed to keep up with real time (possibly zero or several),
+	// so simulation doesn't depend on frame rate. (see FixedTimestep.hpp)
+	float fixed_timestep = 0.0f;
+	// ...and before each 'draw', 'draw_alpha' is set to the fraction of a step that real time is past the last update,
+	// so 'draw' can interpolate between previous and current state. (stays 1.0 if not using a fixed timestep)
+	float draw_alpha = 1.0f;
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
@@ -0,0 +1,185 @@
+#include "PostProcessPrograms.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+#include "RenderStats.hpp"
+
+#include <string>
+
+//All the post-processing programs share a vertex shader that makes a fullscreen triangle from gl_VertexID:
+// (vertices at (0,0), (2,0), (0,2) in screen coordinates, which covers the [0,1]^2 viewport)
+// Input images may only fill part of their texture, so texture coordinates are scaled by 'uv_scale'.
+static const char *fullscreen_vertex_shader =
+	"#version 330\n"
+	"uniform vec2 uv_scale;\n"
+	"out vec2 texCoord;\n"
+	"out vec2 screenCoord;\n"
+	"void main() {\n"
+	"	vec2 at = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	screenCoord = at;\n"
+	"	texCoord = uv_scale * at;\n"
+	"	gl_Position = vec4(2.0 * at - 1.0, 0.0, 1.0);\n"
+	"}\n"
+;
+
+//All the fragment shaders read their input through 'fetch', which keeps lookups inside the part of the texture
+// that holds the image -- otherwise, when the image is smaller than its texture, linear filtering at the right
+// and top edges would blend in stale texels from outside it:
+static const char *fetch_glsl =
+	"uniform sampler2D tex;\n"
+	"uniform vec2 uv_scale;\n"
+	"uniform vec2 texel_size;\n"
+	"vec3 fetch(vec2 at) { return texture(tex, clamp(at, 0.5 * texel_size, uv_scale - 0.5 * texel_size)).rgb; }\n"
+;
+
+//fragment shader source with the 'fetch' helper added after the version line:
+static std::string with_fetch(char const *body) {
+	return std::string("#version 330\n") + fetch_glsl + body;
+}
+
+//point the 'tex' sampler at texture unit 0, default to using the whole input texture, and look up the common uniforms:
+template< typename PROGRAM >
+static void setup_common_uniforms(PROGRAM *program) {
+	glUseProgram(program->program);
+	GLuint tex_sampler2D = glGetUniformLocation(program->program, "tex");
+	glUniform1i(tex_sampler2D, 0);
+	program->uv_scale_vec2 = glGetUniformLocation(program->program, "uv_scale");
+	glUniform2f(program->uv_scale_vec2, 1.0f, 1.0f);
+	program->texel_size_vec2 = glGetUniformLocation(program->program, "texel_size");
+	glUniform2f(program->texel_size_vec2, 0.0f, 0.0f);
+	glUseProgram(0);
+}
+
+CopyProgram::CopyProgram() {
+	program = gl_compile_program(
+		fullscreen_vertex_shader
+		,
+		with_fetch(
+		"in vec2 texCoord;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = vec4(fetch(texCoord), 1.0);\n"
+		"}\n"
+		)
+	);
+
+	setup_common_uniforms(this);
+
+	GL_ERRORS();
+}
+
+ToneMapProgram::ToneMapProgram() {
+	program = gl_compile_program(
+		fullscreen_vertex_shader
+		,
+		with_fetch(
+		"uniform float exposure;\n"
+		"in vec2 texCoord;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	vec3 x = exposure * fetch(texCoord);\n"
+		//Krzysztof Narkowicz's fit of the ACES filmic curve:
+		"	vec3 mapped = (x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14);\n"
+		"	fragColor = vec4(clamp(mapped, 0.0, 1.0), 1.0);\n"
+		"}\n"
+		)
+	);
+
+	exposure_float = glGetUniformLocation(program, "exposure");
+
+	setup_common_uniforms(this);
+
+	GL_ERRORS();
+}
+
+FXAAProgram::FXAAProgram() {
+	program = gl_compile_program(
+		fullscreen_vertex_shader
+		,
+		with_fetch(
+		"in vec2 texCoord;\n"
+		"out vec4 fragColor;\n"
+		"const float REDUCE_MIN = 1.0 / 128.0;\n"
+		"const float REDUCE_MUL = 1.0 / 8.0;\n"
+		"const float SPAN_MAX = 8.0;\n"
+		//input is linear, but edges are judged by perceived brightness, so use an approximate gamma:
+		"float luma(vec3 rgb) { return sqrt(dot(rgb, vec3(0.299, 0.587, 0.114))); }\n"
+		"void main() {\n"
+		"	float nw = luma(fetch(texCoord + vec2(-1.0,-1.0) * texel_size));\n"
+		"	float ne = luma(fetch(texCoord + vec2( 1.0,-1.0) * texel_size));\n"
+		"	float sw = luma(fetch(texCoord + vec2(-1.0, 1.0) * texel_size));\n"
+		"	float se = luma(fetch(texCoord + vec2( 1.0, 1.0) * texel_size));\n"
+		"	vec3 rgbM = fetch(texCoord);\n"
+		"	float m = luma(rgbM);\n"
+		"	float lo = min(m, min(min(nw, ne), min(sw, se)));\n"
+		"	float hi = max(m, max(max(nw, ne), max(sw, se)));\n"
+		//blur direction is along the edge (perpendicular to the luma gradient):
+		"	vec2 dir = vec2(-((nw + ne) - (sw + se)), (nw + sw) - (ne + se));\n"
+		"	float reduce = max((nw + ne + sw + se) * (0.25 * REDUCE_MUL), REDUCE_MIN);\n"
+		"	float scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);\n"
+		"	dir = clamp(dir * scale, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texel_size;\n"
+		"	vec3 a = 0.5 * (\n"
+		"		fetch(texCoord + dir * (1.0 / 3.0 - 0.5))\n"
+		"		+ fetch(texCoord + dir * (2.0 / 3.0 - 0.5)));\n"
+		"	vec3 b = 0.5 * a + 0.25 * (\n"
+		"		fetch(texCoord - 0.5 * dir)\n"
+		"		+ fetch(texCoord + 0.5 * dir));\n"
+		//if the wider blur picked up something outside the local range, it crossed an edge; fall back to the narrow one:
+		"	float lb = luma(b);\n"
+		"	fragColor = vec4((lb < lo || lb > hi) ? a : b, 1.0);\n"
+		"}\n"
+		)
+	);
+
+	setup_common_uniforms(this);
+
+	GL_ERRORS();
+}
+
+VignetteProgram::VignetteProgram() {
+	program = gl_compile_program(
+		fullscreen_vertex_shader
+		,
+		with_fetch(
+		"uniform float strength;\n"
+		"uniform vec2 inner_outer;\n"
+		"in vec2 texCoord;\n"
+		"in vec2 screenCoord;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	float d = length(screenCoord - 0.5) / length(vec2(0.5));\n"
+		"	float dim = strength * smoothstep(inner_outer.x, inner_outer.y, d);\n"
+		"	fragColor = vec4((1.0 - dim) * fetch(texCoord), 1.0);\n"
+		"}\n"
+		)
+	);
+
+	strength_float = glGetUniformLocation(program, "strength");
+	inner_outer_vec2 = glGetUniformLocation(program, "inner_outer");
+
+	setup_common_uniforms(this);
+
+	GL_ERRORS();
+}
+
+Load< CopyProgram > copy_program(LoadTagEarly);
+Load< ToneMapProgram > tone_map_program(LoadTagEarly);
+Load< FXAAProgram > fxaa_program(LoadTagEarly);
+Load< VignetteProgram > vignette_program(LoadTagEarly);
+
+//the fullscreen triangle needs no attributes, but core profile requires *some* vertex array object to be bound:
+static Load< GLuint > empty_vao(LoadTagEarly, [](){
+	GLuint vao = 0;
+	glGenVertexArrays(1, &vao);
+	return new GLuint(vao);
+});
+
+void draw_fullscreen_triangle() {
+	glBindVertexArray(*empty_vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	render_stats.frame.vao_binds += 1;
+	render_stats.frame.draws += 1;
+	render_stats.frame.vertices += 3;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Load.hpp"
+
+//Fullscreen post-processing programs.
+// All of these read their input from texture unit 0 and are drawn with draw_fullscreen_triangle().
+// All of them also have a 'uv_scale' uniform (default (1,1)) giving the fraction of the input texture that holds the image,
+//  and a 'texel_size' uniform (default (0,0)) giving the size of one input texel in texture coordinates;
+//  input lookups are clamped to half a texel inside the image, so filtering never reaches texels outside it.
+
+//CopyProgram just copies (and, with linear filtering, rescales) its input:
+struct CopyProgram {
+	GLuint program = 0;
+
+	//uniform locations:
+	GLuint uv_scale_vec2 = -1U;
+	GLuint texel_size_vec2 = -1U;
+
+	CopyProgram();
+};
+
+//ToneMapProgram maps high-dynamic-range linear color to [0,1]:
+struct ToneMapProgram {
+	GLuint program = 0;
+
+	//uniform locations:
+	GLuint uv_scale_vec2 = -1U;
+	GLuint texel_size_vec2 = -1U;
+	GLuint exposure_float = -1U; //input is scaled by this before tone mapping
+
+	ToneMapProgram();
+};
+
+//FXAAProgram smooths aliased edges (a compact version of Timothy Lottes' FXAA):
+struct FXAAProgram {
+	GLuint program = 0;
+
+	//uniform locations:
+	GLuint uv_scale_vec2 = -1U;
+	GLuint texel_size_vec2 = -1U;
+
+	FXAAProgram();
+};
+
+//VignetteProgram darkens the edges of the image:
+struct VignetteProgram {
+	GLuint program = 0;
+
+	//uniform locations:
+	GLuint uv_scale_vec2 = -1U;
+	GLuint texel_size_vec2 = -1U;
+	GLuint strength_float = -1U; //amount of darkening at the corners (0 = none, 1 = black)
+	GLuint inner_outer_vec2 = -1U; //darkening ramps up between these distances from the center (in units of the half-diagonal)
+
+	VignetteProgram();
+};
+
+extern Load< CopyProgram > copy_program;
+extern Load< ToneMapProgram > tone_map_program;
+extern Load< FXAAProgram > fxaa_program;
+extern Load< VignetteProgram > vignette_program;
+
+//draw a triangle that covers the whole viewport (with texCoord going from 0 to 1 across it):
+void draw_fullscreen_triangle();
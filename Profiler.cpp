@@ -0,0 +1,175 @@
+#include "Profiler.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+Profiler profiler;
+
+double Profiler::now_us() {
+	static auto const start = std::chrono::steady_clock::now();
+	return std::chrono::duration< double, std::micro >(std::chrono::steady_clock::now() - start).count();
+}
+
+//small, stable per-thread numbers for traces: (0 is reserved for the GPU)
+static uint32_t thread_number() {
+	static std::atomic< uint32_t > next(1);
+	thread_local uint32_t number = next++;
+	return number;
+}
+
+ProfileScope::~ProfileScope() {
+	profiler.add_cpu(name, begin_us, Profiler::now_us());
+}
+
+void Profiler::Rolling::add(float t) {
+	ms[next] = t;
+	next = (next + 1) % Window;
+	count = std::min< uint32_t >(count + 1, Window);
+}
+
+void Profiler::add_cpu(char const *name, double begin_us, double end_us) {
+	uint32_t thread = thread_number();
+	std::unique_lock< std::mutex > lock(mutex);
+	cpu_stats[name].add(float((end_us - begin_us) / 1000.0));
+	if (tracing && trace.size() < max_trace_events) {
+		trace.emplace_back(Event{ name, thread, frame, begin_us, end_us - begin_us });
+	}
+}
+
+void Profiler::gpu_begin(char const *name) {
+	assert(!gpu_timing && "gpu_begin() called twice without gpu_end()");
+	if (pending.size() >= MaxPending) {
+		//results are way behind; rather than stall, skip this span:
+		return;
+	}
+	GLuint query = 0;
+	if (!free_queries.empty()) {
+		query = free_queries.back();
+		free_queries.pop_back();
+	} else {
+		glGenQueries(1, &query);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	pending.emplace_back(Pending{ query, name, frame, now_us() });
+	gpu_timing = true;
+}
+
+void Profiler::gpu_end() {
+	if (!gpu_timing) return; //span was skipped in gpu_begin()
+	glEndQuery(GL_TIME_ELAPSED);
+	gpu_timing = false;
+}
+
+void Profiler::end_frame() {
+	assert(!gpu_timing && "end_frame() called between gpu_begin() and gpu_end()");
+
+	//collect finished GPU spans: (queries finish in order, so stop at the first unfinished one)
+	while (!pending.empty()) {
+		Pending const &p = pending.front();
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(p.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(p.query, GL_QUERY_RESULT, &ns);
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			gpu_stats[p.name].add(float(double(ns) / 1.0e6));
+			if (tracing && trace.size() < max_trace_events) {
+				trace.emplace_back(Event{ p.name, GPUThread, p.frame, p.issued_us, double(ns) / 1.0e3 });
+			}
+		}
+		free_queries.emplace_back(p.query);
+		pending.pop_front();
+	}
+	GL_ERRORS();
+
+	//the frame itself:
+	double end_us = now_us();
+	if (frame_begin_us != 0.0) add_cpu("frame", frame_begin_us, end_us);
+	frame_begin_us = end_us;
+
+	std::unique_lock< std::mutex > lock(mutex);
+	frame += 1;
+}
+
+void Profiler::print_stats(std::ostream &out) {
+	std::unique_lock< std::mutex > lock(mutex);
+	auto print = [&out](char const *label, std::unordered_map< std::string_view, Rolling > const &stats) {
+		//(sorted by name, so output is easy to compare)
+		std::map< std::string_view, Rolling const * > sorted;
+		for (auto const &[name, rolling] : stats) sorted.emplace(name, &rolling);
+		for (auto const &[name, rolling] : sorted) {
+			std::vector< float > ms;
+			ms.reserve(rolling->count);
+			for (uint32_t i = 0; i < rolling->count; ++i) ms.emplace_back(rolling->ms[i]);
+			if (ms.empty()) continue;
+			std::sort(ms.begin(), ms.end());
+			double total = 0.0;
+			for (float m : ms) total += m;
+			out << "  " << label << " " << name << ": min " << ms.front() << "ms, avg " << total / double(ms.size()) << "ms, p99 " << ms[std::min(ms.size() - 1, size_t(0.99 * double(ms.size())))] << "ms (last " << ms.size() << ")" << std::endl;
+		}
+	};
+	out << "Profile at frame " << frame << ":" << std::endl;
+	print("CPU", cpu_stats);
+	print("GPU", gpu_stats);
+}
+
+void Profiler::start_trace() {
+	std::unique_lock< std::mutex > lock(mutex);
+	trace.clear();
+	tracing = true;
+}
+
+void Profiler::stop_trace(std::string const &filename) {
+	std::unique_lock< std::mutex > lock(mutex);
+	tracing = false;
+
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' to write trace.");
+
+	auto quoted = [](char const *name) {
+		std::string ret = "\"";
+		for (char const *c = name; *c; ++c) {
+			if (*c == '"' || *c == '\\') ret += '\\';
+			ret += *c;
+		}
+		return ret + "\"";
+	};
+
+	//"complete" (ph:X) events, in microseconds, with thread names as metadata:
+	out << std::fixed << std::setprecision(3); //(timestamps are big numbers of microseconds)
+	out << "{\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GPUThread << ",\"args\":{\"name\":\"GPU\"}}";
+	for (Event const &e : trace) {
+		out << ",\n{\"name\":" << quoted(e.name)
+			<< ",\"cat\":\"" << (e.thread == GPUThread ? "gpu" : "cpu")
+			<< "\",\"ph\":\"X\",\"ts\":" << e.begin_us << ",\"dur\":" << e.duration_us
+			<< ",\"pid\":0,\"tid\":" << e.thread << ",\"args\":{\"frame\":" << e.frame << "}}";
+	}
+	out << "\n]}\n";
+
+	std::cout << "Wrote " << trace.size() << " profile events to '" << filename << "'." << std::endl;
+	trace.clear();
+}
+
+void Profiler::clear() {
+	for (Pending const &p : pending) {
+		glDeleteQueries(1, &p.query);
+	}
+	pending.clear();
+	if (!free_queries.empty()) {
+		glDeleteQueries(GLsizei(free_queries.size()), free_queries.data());
+	}
+	free_queries.clear();
+	gpu_timing = false;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+/*
+ * The Profiler collects timings for named spans of CPU and GPU work:
+ *  - CPU spans are marked with a ProfileScope (from any thread);
+ *  - GPU spans (render passes) are bracketed with gpu_begin() / gpu_end(),
+ *    using GL_TIME_ELAPSED queries that are read back a few frames later,
+ *    once their results are ready, so the CPU never waits on the GPU.
+ *
+ * It keeps rolling min / avg / p99 statistics for each span name, and can
+ *  capture every span to a Chrome trace file (open in chrome://tracing or
+ *  https://ui.perfetto.dev).
+ *
+ * Usage:
+ *  { ProfileScope scope("Scene::submit"); ... } //time the rest of the block
+ *
+ *  profiler.gpu_begin("shadow map"); ...draw... profiler.gpu_end();
+ *
+ *  //...once per frame, after the last gpu_end():
+ *  profiler.end_frame();
+ *
+ *  profiler.print_stats(std::cout);
+ *  profiler.start_trace(); ...frames... profiler.stop_trace("trace.json");
+ *
+ * Span names are kept by pointer, so must outlive the profiler (string literals are good).
+ *
+ */
+
+#include "GL.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Profiler {
+	Profiler() = default;
+
+	//since profiler owns OpenGL objects, copying isn't a good idea:
+	Profiler(Profiler const &) = delete;
+
+	//microseconds since the program started:
+	static double now_us();
+
+	//record a finished CPU span: (ProfileScope does this for you)
+	void add_cpu(char const *name, double begin_us, double end_us);
+
+	//bracket GPU commands to time: (spans can't nest; only call from the thread with the OpenGL context)
+	// (if too many queries are already waiting on results, the span is skipped)
+	void gpu_begin(char const *name);
+	void gpu_end();
+
+	//call once per frame: collects finished GPU timings and times the frame itself (as span "frame")
+	void end_frame();
+
+	//print rolling statistics for every span name:
+	void print_stats(std::ostream &out);
+
+	//capture all spans from now on, until stop_trace() writes them to a Chrome trace (JSON) file:
+	void start_trace();
+	void stop_trace(std::string const &filename);
+	bool tracing = false;
+	size_t max_trace_events = 1000000; //(capture stops growing past this)
+
+	//free queries:
+	// (n.b. not done in a destructor, since profilers often live at global scope and outlive the OpenGL context)
+	void clear();
+
+	//-- internals ---
+	std::mutex mutex; //guards everything but the GPU query state
+
+	uint32_t frame = 0;
+	double frame_begin_us = 0.0;
+
+	//last Window timings for a span name:
+	struct Rolling {
+		enum : uint32_t { Window = 240 };
+		std::array< float, Window > ms;
+		uint32_t next = 0;
+		uint32_t count = 0;
+		void add(float t);
+	};
+	std::unordered_map< std::string_view, Rolling > cpu_stats, gpu_stats;
+
+	struct Event {
+		char const *name = nullptr;
+		uint32_t thread = 0; //(GPU events use GPUThread)
+		uint32_t frame = 0;
+		double begin_us = 0.0;
+		double duration_us = 0.0;
+	};
+	enum : uint32_t { GPUThread = 0 };
+	std::vector< Event > trace;
+
+	//GPU queries waiting on results, oldest first:
+	enum : uint32_t { MaxPending = 64 };
+	struct Pending {
+		GLuint query = 0;
+		char const *name = nullptr;
+		uint32_t frame = 0;
+		double issued_us = 0.0; //(GL_TIME_ELAPSED doesn't say when the GPU started, so traces place GPU spans when they were issued)
+	};
+	std::deque< Pending > pending;
+	std::vector< GLuint > free_queries;
+	bool gpu_timing = false;
+};
+
+//times from construction to destruction:
+struct ProfileScope {
+	explicit ProfileScope(char const *name_) : name(name_), begin_us(Profiler::now_us()) { }
+	~ProfileScope();
+	char const *name;
+	double begin_us;
+};
+
+//the profiler everything reports to:
+// (main loop calls end_frame() after each frame is drawn)
+extern Profiler profiler;
@@ -0,0 +1,56 @@
+#include "RenderStats.hpp"
+
+#include <iostream>
+
+RenderStats render_stats;
+
+RenderStats::Counts &RenderStats::Counts::operator+=(Counts const &o) {
+	draws += o.draws;
+	vertices += o.vertices;
+	culled += o.culled;
+	program_binds += o.program_binds;
+	vao_binds += o.vao_binds;
+	texture_binds += o.texture_binds;
+	uniform_uploads += o.uniform_uploads;
+	buffer_bytes += o.buffer_bytes;
+	return *this;
+}
+
+RenderStats::Counts RenderStats::Counts::operator-(Counts const &o) const {
+	Counts ret;
+	ret.draws = draws - o.draws;
+	ret.vertices = vertices - o.vertices;
+	ret.culled = culled - o.culled;
+	ret.program_binds = program_binds - o.program_binds;
+	ret.vao_binds = vao_binds - o.vao_binds;
+	ret.texture_binds = texture_binds - o.texture_binds;
+	ret.uniform_uploads = uniform_uploads - o.uniform_uploads;
+	ret.buffer_bytes = buffer_bytes - o.buffer_bytes;
+	return ret;
+}
+
+bool RenderStats::Counts::operator==(Counts const &o) const {
+	return draws == o.draws
+	    && vertices == o.vertices
+	    && culled == o.culled
+	    && program_binds == o.program_binds
+	    && vao_binds == o.vao_binds
+	    && texture_binds == o.texture_binds
+	    && uniform_uploads == o.uniform_uploads
+	    && buffer_bytes == o.buffer_bytes;
+}
+
+void RenderStats::Counts::write_csv_header(std::ostream &out) {
+	out << "draws,vertices,culled,program_binds,vao_binds,texture_binds,uniform_uploads,buffer_bytes";
+}
+
+void RenderStats::Counts::write_csv(std::ostream &out) const {
+	out << draws << ',' << vertices << ',' << culled << ',' << program_binds << ',' << vao_binds << ',' << texture_binds << ',' << uniform_uploads << ',' << buffer_bytes;
+}
+
+void RenderStats::end_frame() {
+	last_frame = frame;
+	total += frame;
+	frames += 1;
+	frame = Counts();
+}
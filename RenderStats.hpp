@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ * RenderStats counts the work each frame sends to OpenGL -- draw calls,
+ *  vertices, state changes, and uploads -- so the cost of a frame can be
+ *  checked from code (and compared between builds: with a fixed camera
+ *  path, counts are the same from run to run).
+ *
+ * Drawing code adds to render_stats.frame as it issues commands:
+ *  render_stats.frame.draws += 1;
+ *  render_stats.frame.vertices += count;
+ *
+ * ...and the main loop calls render_stats.end_frame() after each frame,
+ *  which moves the counts to render_stats.last_frame.
+ *
+ */
+
+#include <cstdint>
+#include <iosfwd>
+
+struct RenderStats {
+	struct Counts {
+		uint32_t draws = 0; //draw calls
+		uint64_t vertices = 0; //vertices submitted by those calls
+		uint32_t culled = 0; //drawables recorded for a pass but not drawn (see Scene::record)
+		uint32_t program_binds = 0; //glUseProgram calls (not counting unbinding)
+		uint32_t vao_binds = 0; //glBindVertexArray calls (not counting unbinding)
+		uint32_t texture_binds = 0; //glBindTexture calls (not counting unbinding)
+		uint32_t uniform_uploads = 0; //glUniform* calls, uniform block binds, and set_uniforms callbacks
+		uint64_t buffer_bytes = 0; //bytes of buffer data uploaded (e.g., streamed uniform blocks)
+
+		Counts &operator+=(Counts const &o);
+		Counts operator-(Counts const &o) const;
+		bool operator==(Counts const &o) const;
+		bool operator!=(Counts const &o) const { return !(*this == o); }
+
+		//CSV columns, in the same order as the members:
+		static void write_csv_header(std::ostream &out); //(no trailing newline)
+		void write_csv(std::ostream &out) const; //(no trailing newline)
+	};
+
+	Counts frame; //counts for the frame being drawn
+	Counts last_frame; //counts for the most recent complete frame
+	Counts total; //counts for all complete frames
+	uint32_t frames = 0; //complete frames
+
+	//call once per frame, after all drawing:
+	void end_frame();
+};
+
+//stats shared by everything that draws:
+// (main loop calls end_frame() after each frame is drawn)
+extern RenderStats render_stats;
@@ -0,0 +1,81 @@
+#include "RenderTargetPool.hpp"
+
+#include "gl_errors.hpp"
+#include "gl_check_fb.hpp"
+
+#include <cassert>
+
+static void free_target(RenderTarget &target) {
+	glDeleteFramebuffers(1, &target.fb);
+	target.fb = 0;
+	glDeleteTextures(1, &target.tex);
+	target.tex = 0;
+}
+
+void RenderTargetPool::clear() {
+	for (auto &target : targets) {
+		assert(!target.in_use && "all targets should be released before clear()");
+		free_target(target);
+	}
+	targets.clear();
+}
+
+RenderTarget *RenderTargetPool::acquire(glm::uvec2 const &size, GLenum internal_format) {
+	//re-use an idle target if one matches:
+	for (auto &target : targets) {
+		if (!target.in_use && target.size == size && target.internal_format == internal_format) {
+			target.in_use = true;
+			target.last_used_frame = frame;
+			return &target;
+		}
+	}
+
+	//otherwise, make a new one:
+	targets.emplace_back();
+	RenderTarget &target = targets.back();
+	target.size = size;
+	target.internal_format = internal_format;
+	target.in_use = true;
+	target.last_used_frame = frame;
+
+	glGenTextures(1, &target.tex);
+	glBindTexture(GL_TEXTURE_2D, target.tex);
+	//n.b. the format and type parameters only describe the (absent) upload data, so these work for any color format:
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &target.fb);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.fb);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.tex, 0);
+	gl_check_fb();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GL_ERRORS();
+
+	allocations += 1;
+
+	return &target;
+}
+
+void RenderTargetPool::release(RenderTarget *target) {
+	assert(target);
+	assert(target->in_use && "releasing a target that wasn't acquired");
+	target->in_use = false;
+}
+
+void RenderTargetPool::end_frame() {
+	for (auto ti = targets.begin(); ti != targets.end(); /* later */) {
+		assert(!ti->in_use && "all targets should be released before end_frame()");
+		if (frame - ti->last_used_frame > max_idle_frames) {
+			free_target(*ti);
+			ti = targets.erase(ti);
+		} else {
+			++ti;
+		}
+	}
+	frame += 1;
+}
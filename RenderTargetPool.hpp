@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * A RenderTargetPool hands out color render targets (a texture + framebuffer)
+ *  for transient use within a frame -- e.g., ping-pong buffers for fullscreen
+ *  effects -- and keeps them around so later frames can reuse them instead
+ *  of reallocating.
+ *
+ * Usage:
+ *  RenderTarget *rt = pool.acquire(size, GL_SRGB8_ALPHA8);
+ *  glBindFramebuffer(GL_FRAMEBUFFER, rt->fb); //...draw...
+ *  pool.release(rt);
+ *  //...once per frame:
+ *  pool.end_frame();
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <list>
+
+struct RenderTarget {
+	glm::uvec2 size = glm::uvec2(0);
+	GLenum internal_format = 0;
+	GLuint tex = 0; //color texture (linear filtering, clamp-to-edge)
+	GLuint fb = 0; //framebuffer with 'tex' as color attachment 0
+
+	//tracked by the pool:
+	bool in_use = false;
+	uint32_t last_used_frame = 0;
+};
+
+struct RenderTargetPool {
+	RenderTargetPool() = default;
+
+	//since pool owns OpenGL objects, copying isn't a good idea:
+	RenderTargetPool(RenderTargetPool const &) = delete;
+
+	//free all targets:
+	// (n.b. not done in a destructor, since pools often live at global scope and outlive the OpenGL context)
+	void clear();
+
+	//get a target of exactly this size and format, reusing an idle one if possible:
+	// (contents are undefined)
+	RenderTarget *acquire(glm::uvec2 const &size, GLenum internal_format);
+
+	//return a target to the pool; it may be handed out again this frame:
+	void release(RenderTarget *target);
+
+	//call once per frame, after all targets are released:
+	// frees targets that haven't been used in a while (e.g., ones at a stale size)
+	void end_frame();
+
+	//targets unused for more than this many frames get freed:
+	uint32_t max_idle_frames = 60;
+
+	//statistics (useful for checking that reuse actually happens):
+	uint32_t frame = 0;
+	uint32_t allocations = 0; //total targets ever allocated
+
+	//-- internals ---
+	std::list< RenderTarget > targets; //list so pointers stay stable
+};
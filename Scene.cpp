@@ -2,10 +2,18 @@
 
 #include "gl_errors.hpp"
 #include "read_write_chunk.hpp"
+#include "file_entries.hpp"
+#include "JobSystem.hpp"
+#include "GPURingBuffer.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 //-------------------------
 
@@ -74,14 +82,42 @@ glm::mat4x3 Scene::Transform::make_local_from_world() const {
 //-------------------------
 
 glm::mat4 Scene::Camera::make_projection() const {
-	return glm::infinitePerspective( fovy, aspect, near );
+	if (depth == DepthStandard) {
+		return glm::infinitePerspective( fovy, aspect, near );
+	}
+
+	//reversed-Z infinite perspective:
+	// clip.w is distance along the view direction (-z), and clip.z is constant,
+	// so depth falls off as near / distance and only reaches its far value at infinity:
+	float f = 1.0f / std::tan(0.5f * fovy);
+	glm::mat4 ret(0.0f);
+	ret[0][0] = f / aspect;
+	ret[1][1] = f;
+	ret[2][3] = -1.0f;
+	if (depth == DepthReversedZeroToOne) {
+		//depth = near / -z, in [0,1]:
+		ret[3][2] = near;
+	} else { assert(depth == DepthReversed);
+		//depth = 2 * near / -z - 1, in [-1,1]:
+		ret[2][2] = 1.0f;
+		ret[3][2] = 2.0f * near;
+	}
+	return ret;
 }
 
 //-------------------------
 
 glm::mat4 Scene::Light::make_projection() const {
 	assert(type == Spot);
-	return glm::perspective( spot_fov, 1.0f, clip_start, clip_end );
+	if (depth == DepthStandard) {
+		return glm::perspective( spot_fov, 1.0f, clip_start, clip_end );
+	}
+	//swapping the near and far planes reverses depth:
+	if (depth == DepthReversedZeroToOne) {
+		return glm::perspectiveRH_ZO( spot_fov, 1.0f, clip_end, clip_start );
+	} else { assert(depth == DepthReversed);
+		return glm::perspectiveRH_NO( spot_fov, 1.0f, clip_end, clip_start );
+	}
 }
 
 //-------------------------
@@ -101,71 +137,213 @@ void Scene::draw(Light const &light, Drawable::PipelineType pipeline_type) const
 }
 
 void Scene::draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world, Drawable::PipelineType pipeline_type) const {
+	ProfileScope scope("Scene::draw");
+
+	//(reused between calls to avoid reallocating; draw is only ever called from the thread that owns the GL context)
+	static DrawList list;
+	record(clip_from_world, light_from_world, pipeline_type, &list);
+	submit(list);
+}
+
+void Scene::record(Camera const &camera, Drawable::PipelineType pipeline_type, DrawList *list, float lod_bias) const {
+	assert(camera.transform);
+	glm::mat4 clip_from_world = camera.make_projection() * glm::mat4(camera.transform->make_local_from_world());
+	glm::mat4x3 light_from_world = glm::mat4x3(1.0f);
+	record(clip_from_world, light_from_world, pipeline_type, list, lod_bias);
+}
+
+void Scene::record(Light const &light, Drawable::PipelineType pipeline_type, DrawList *list, float lod_bias) const {
+	assert(light.transform);
+	glm::mat4 clip_from_world = light.make_projection() * glm::mat4(light.transform->make_local_from_world());
+	glm::mat4x3 light_from_world = glm::mat4x3(1.0f);
+	record(clip_from_world, light_from_world, pipeline_type, list, lod_bias);
+}
 
-	//Iterate through all drawables, sending each one to OpenGL:
+void Scene::record(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world, Drawable::PipelineType pipeline_type, DrawList *list, float lod_bias) const {
+	assert(list);
+	ProfileScope scope("Scene::record");
+
+	//Gather all drawables that will be drawn:
+	// (the drawables pool may have free slots, so is awkward to split up for parallel processing; a flat array isn't)
+	list->drawables.clear();
 	for (auto const &drawable : drawables) {
-		//Reference to drawable's pipeline for convenience:
-		Scene::Drawable::Pipeline const &pipeline = drawable.pipelines[pipeline_type];
+		//skip any drawables without a material, program, vertex array, or vertices:
+		if (!get_material(drawable, pipeline_type)) continue;
 
-		//skip any drawables without a shader program set:
-		if (pipeline.program == 0) continue;
-		//skip any drawables that don't reference any vertex array:
-		if (pipeline.vao == 0) continue;
-		//skip any drawables that don't contain any vertices:
-		if (pipeline.count == 0) continue;
+		list->drawables.emplace_back(&drawable);
+	}
+	list->culled = drawables.size() - uint32_t(list->drawables.size());
+
+	//Level-of-detail selection needs each drawable's projected size, which is its bounding radius times
+	// the projection's vertical scale (the length of clip_from_world's 'y' row, for a rigid view transform)
+	// over clip 'w' (the distance in front of the view, for a perspective projection; 1 for orthographic):
+	float lod_scale = glm::length(glm::vec3(clip_from_world[0][1], clip_from_world[1][1], clip_from_world[2][1])) / Drawable::LODFullSize;
+	glm::vec4 w_from_world = glm::vec4(clip_from_world[0][3], clip_from_world[1][3], clip_from_world[2][3], clip_from_world[3][3]);
+
+	//Compute the matrices each one will need, in parallel chunks:
+	list->items.resize(list->drawables.size());
+	JobSystem::shared().parallel_for(uint32_t(list->items.size()), DrawList::RecordChunk, [&](uint32_t begin, uint32_t end){
+		for (uint32_t i = begin; i < end; ++i) {
+			Drawable const &drawable = *list->drawables[i];
+			Scene::Drawable::Pipeline const &pipeline = drawable.pipelines[pipeline_type];
+			Material const &material = *materials[pipeline.material];
+
+			DrawList::Item &item = list->items[i];
+			item.material = &material;
+			item.pipeline = pipeline;
+
+			//the object-to-world matrix is used in all three of these matrices:
+			assert(drawable.transform); //drawables *must* have a transform
+			glm::mat4x3 world_from_object = drawable.transform->make_world_from_local();
+
+			//pick a level of detail:
+			if (drawable.lod.count != 0) {
+				Drawable::LOD const &lod = drawable.lod;
+				glm::vec3 center = world_from_object * glm::vec4(lod.center, 1.0f);
+				float scale = std::max(glm::length(world_from_object[0]), std::max(glm::length(world_from_object[1]), glm::length(world_from_object[2])));
+				float radius = lod.radius * scale;
+				float w = glm::dot(w_from_world, glm::vec4(center, 1.0f));
+				if (w > 0.0f) { //(drawables centered behind the viewer keep full detail)
+					//coverage relative to LODFullSize; each halving is one more level:
+					float size = radius * lod_scale / w;
+					float level = std::ceil(-std::log2(std::max(size, 1e-30f)) + lod_bias);
+					if (level >= 1.0f) {
+						Drawable::LOD::Range const &range = lod.ranges[uint32_t(std::min(level, float(lod.count))) - 1];
+						item.pipeline.start = range.start;
+						item.pipeline.count = range.count;
+					}
+				}
+			}
 
+			//CLIP_FROM_OBJECT takes vertices from object space to clip space:
+			if (material.object_block || material.CLIP_FROM_OBJECT_mat4 != -1U) {
+				item.clip_from_object = clip_from_world * glm::mat4(world_from_object);
+			}
 
-		//Set shader program:
-		glUseProgram(pipeline.program);
+			//the object-to-light matrix is used in the next two uniforms:
+			item.light_from_object = light_from_world * glm::mat4(world_from_object);
 
-		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+			//LIGHT_FROM_NORMAL takes normals from object space to light space:
+			if (material.object_block || material.LIGHT_FROM_NORMAL_mat3 != -1U) {
+				item.light_from_normal = glm::inverse(glm::transpose(glm::mat3(item.light_from_object)));
+			}
+		}
+	});
+}
 
-		//Configure program uniforms:
+void Scene::submit(DrawList const &list) {
+	ProfileScope scope("Scene::submit");
+
+	//Matrices for all pipelines using the object block go into one allocation from the frame ring:
+	// (blocks must start at multiples of the uniform buffer offset alignment)
+	GLsizeiptr object_alignment = frame_ring.alignment(GPURingBuffer::Uniform);
+	GLsizeiptr object_stride = (GLsizeiptr(sizeof(ObjectBlock)) + object_alignment - 1) / object_alignment * object_alignment;
+	GPURingBuffer::Allocation objects;
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 world_from_object = drawable.transform->make_world_from_local();
+	//counts go into local stats, which are added to render_stats at the end:
+	RenderStats::Counts stats;
+	stats.culled = list.culled;
 
-		//CLIP_FROM_OBJECT takes vertices from object space to clip space:
-		if (pipeline.CLIP_FROM_OBJECT_mat4 != -1U) {
-			glm::mat4 clip_from_object = clip_from_world * glm::mat4(world_from_object);
-			glUniformMatrix4fv(pipeline.CLIP_FROM_OBJECT_mat4, 1, GL_FALSE, glm::value_ptr(clip_from_object));
+	{ //fill the allocation:
+		uint32_t blocks = 0;
+		for (auto const &item : list.items) {
+			if (item.material->object_block) blocks += 1;
 		}
+		if (blocks != 0) {
+			objects = frame_ring.allocate(blocks * object_stride, GPURingBuffer::Uniform);
+			uint8_t *dest = reinterpret_cast< uint8_t * >(objects.data);
+			for (auto const &item : list.items) {
+				if (!item.material->object_block) continue;
+				ObjectBlock data;
+				data.clip_from_object = item.clip_from_object;
+				for (uint32_t c = 0; c < 4; ++c) data.light_from_object[c] = glm::vec4(item.light_from_object[c], 0.0f);
+				for (uint32_t c = 0; c < 3; ++c) data.light_from_normal[c] = glm::vec4(item.light_from_normal[c], 0.0f);
+				std::memcpy(dest, &data, sizeof(data)); //(n.b. buffer may be write-combined memory, so write it once, in order)
+				dest += object_stride;
+			}
+			frame_ring.flush();
+			stats.buffer_bytes += objects.size;
+		}
+	}
+
+	//track bound program and vertex array to skip redundant binds:
+	GLuint bound_program = 0;
+	GLuint bound_vao = 0;
+	uint32_t block = 0;
+
+	//Iterate through all recorded items, sending each one to OpenGL:
+	for (auto const &item : list.items) {
+		//Reference to item's material and vertex range for convenience:
+		assert(item.material);
+		Material const &material = *item.material;
+		Drawable::Pipeline const &pipeline = item.pipeline;
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 light_from_object = light_from_world * glm::mat4(world_from_object);
+		//Set shader program:
+		if (material.program != bound_program) {
+			glUseProgram(material.program);
+			bound_program = material.program;
+			stats.program_binds += 1;
+		}
 
-		//CLIP_FROM_OBJECT takes vertices from object space to light space:
-		if (pipeline.LIGHT_FROM_OBJECT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.LIGHT_FROM_OBJECT_mat4x3, 1, GL_FALSE, glm::value_ptr(light_from_object));
+		//Set attribute sources:
+		if (material.vao != bound_vao) {
+			glBindVertexArray(material.vao);
+			bound_vao = material.vao;
+			stats.vao_binds += 1;
 		}
 
-		//LIGHT_FROM_NORMAL takes normals from object space to light space:
-		if (pipeline.LIGHT_FROM_NORMAL_mat3 != -1U) {
-			glm::mat3 light_from_normal = glm::inverse(glm::transpose(glm::mat3(light_from_object)));
-			glUniformMatrix3fv(pipeline.LIGHT_FROM_NORMAL_mat3, 1, GL_FALSE, glm::value_ptr(light_from_normal));
+		//Configure program uniforms:
+
+		if (material.object_block) {
+			//point the object block at this item's part of the buffer:
+			glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBlockBinding, objects.buffer, objects.offset + block * object_stride, sizeof(ObjectBlock));
+			block += 1;
+			stats.uniform_uploads += 1;
+		} else {
+			//CLIP_FROM_OBJECT takes vertices from object space to clip space:
+			if (material.CLIP_FROM_OBJECT_mat4 != -1U) {
+				glUniformMatrix4fv(material.CLIP_FROM_OBJECT_mat4, 1, GL_FALSE, glm::value_ptr(item.clip_from_object));
+				stats.uniform_uploads += 1;
+			}
+
+			//LIGHT_FROM_OBJECT takes vertices from object space to light space:
+			if (material.LIGHT_FROM_OBJECT_mat4x3 != -1U) {
+				glUniformMatrix4x3fv(material.LIGHT_FROM_OBJECT_mat4x3, 1, GL_FALSE, glm::value_ptr(item.light_from_object));
+				stats.uniform_uploads += 1;
+			}
+
+			//LIGHT_FROM_NORMAL takes normals from object space to light space:
+			if (material.LIGHT_FROM_NORMAL_mat3 != -1U) {
+				glUniformMatrix3fv(material.LIGHT_FROM_NORMAL_mat3, 1, GL_FALSE, glm::value_ptr(item.light_from_normal));
+				stats.uniform_uploads += 1;
+			}
 		}
 
 		//set any requested custom uniforms:
-		if (pipeline.set_uniforms) pipeline.set_uniforms();
+		if (material.set_uniforms) {
+			material.set_uniforms();
+			stats.uniform_uploads += 1; //(counted as one, whatever it does)
+		}
 
 		//set up textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
+		for (uint32_t i = 0; i < Material::TextureCount; ++i) {
+			if (material.textures[i].texture != 0) {
 				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+				glBindTexture(material.textures[i].target, material.textures[i].texture);
+				stats.texture_binds += 1;
 			}
 		}
 
 		//draw the object:
 		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		stats.draws += 1;
+		stats.vertices += pipeline.count;
 
 		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
+		for (uint32_t i = 0; i < Material::TextureCount; ++i) {
+			if (material.textures[i].texture != 0) {
 				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
+				glBindTexture(material.textures[i].target, 0);
 			}
 		}
 		glActiveTexture(GL_TEXTURE0);
@@ -175,58 +353,145 @@ void Scene::draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from
 	glUseProgram(0);
 	glBindVertexArray(0);
 
+	render_stats.frame += stats;
+
 	GL_ERRORS();
 }
 
+Scene::Complexity Scene::complexity(Drawable::PipelineType pipeline_type) const {
+	Complexity ret;
+	for (auto const &drawable : drawables) {
+		//same skip conditions as in draw():
+		if (!get_material(drawable, pipeline_type)) continue;
+
+		ret.drawables += 1;
+		ret.vertices += drawable.pipelines[pipeline_type].count;
+	}
+	return ret;
+}
+
+uint32_t Scene::add_material(std::shared_ptr< Material > const &material) {
+	assert(material);
+	materials.emplace_back(material);
+	return uint32_t(materials.size() - 1);
+}
+
+void Scene::NameIndex::clear() {
+	table.clear();
+	count = 0;
+}
+
+void Scene::NameIndex::add(uint32_t hash, uint32_t index) {
+	assert(index != Empty);
+	//keep the table at most half full (so probe sequences stay short):
+	if (2 * (count + 1) > table.size()) {
+		std::vector< Entry > old = std::move(table);
+		table.assign(std::max< size_t >(16, old.size() * 2), Entry());
+		count = 0;
+		for (Entry const &e : old) {
+			if (e.index != Empty) add(e.hash, e.index);
+		}
+	}
+	uint32_t mask = uint32_t(table.size() - 1);
+	uint32_t i = hash & mask;
+	while (table[i].index != Empty) i = (i + 1) & mask;
+	table[i].hash = hash;
+	table[i].index = index;
+	count += 1;
+}
+
+void Scene::index_names() {
+	transform_names.clear();
+	for (auto t = transforms.begin(); t != transforms.end(); ++t) {
+		transform_names.add(NameIndex::hash(t->name), t.index);
+	}
+	camera_names.clear();
+	for (auto c = cameras.begin(); c != cameras.end(); ++c) {
+		camera_names.add(NameIndex::hash(c->transform->name), c.index);
+	}
+	light_names.clear();
+	for (auto l = lights.begin(); l != lights.end(); ++l) {
+		light_names.add(NameIndex::hash(l->transform->name), l.index);
+	}
+}
+
+//every element of 'pool' whose name (per 'name_of') is 'name', in index order:
+template< typename T, typename N >
+static std::vector< T * > find_all(ChunkedPool< T > &pool, Scene::NameIndex const &index, InternedString name, N const &name_of) {
+	std::vector< T * > ret;
+	index.find(Scene::NameIndex::hash(name), [&](uint32_t i){
+		if (name_of(pool[i]) == name) ret.emplace_back(&pool[i]);
+	});
+	//(probe order isn't index order)
+	std::sort(ret.begin(), ret.end(), [&](T *a, T *b){ return pool.index_of(a) < pool.index_of(b); });
+	return ret;
+}
+
+//...and the first such element (or nullptr):
+template< typename T, typename N >
+static T *find_first(ChunkedPool< T > &pool, Scene::NameIndex const &index, InternedString name, N const &name_of) {
+	uint32_t first = Scene::NameIndex::Empty;
+	index.find(Scene::NameIndex::hash(name), [&](uint32_t i){
+		if (i < first && name_of(pool[i]) == name) first = i;
+	});
+	return (first == Scene::NameIndex::Empty ? nullptr : &pool[first]);
+}
+
+static InternedString transform_name(Scene::Transform const &t) { return t.name; }
+template< typename T >
+static InternedString transform_name_of(T const &t) { return t.transform->name; }
+
+Scene::Transform *Scene::find_transform(InternedString name) {
+	return find_first(transforms, transform_names, name, transform_name);
+}
+Scene::Camera *Scene::find_camera(InternedString name) {
+	return find_first(cameras, camera_names, name, transform_name_of< Camera >);
+}
+Scene::Light *Scene::find_light(InternedString name) {
+	return find_first(lights, light_names, name, transform_name_of< Light >);
+}
+std::vector< Scene::Transform * > Scene::find_transforms(InternedString name) {
+	return find_all(transforms, transform_names, name, transform_name);
+}
+std::vector< Scene::Camera * > Scene::find_cameras(InternedString name) {
+	return find_all(cameras, camera_names, name, transform_name_of< Camera >);
+}
+std::vector< Scene::Light * > Scene::find_lights(InternedString name) {
+	return find_all(lights, light_names, name, transform_name_of< Light >);
+}
+
+Scene::Material const *Scene::get_material(Drawable const &drawable, Drawable::PipelineType pipeline_type) const {
+	Drawable::Pipeline const &pipeline = drawable.pipelines[pipeline_type];
+	if (pipeline.material == NoMaterial) return nullptr;
+	assert(pipeline.material < materials.size());
+	Material const *material = materials[pipeline.material].get();
+	//skip any drawables without a shader program set:
+	if (material->program == 0) return nullptr;
+	//skip any drawables that don't reference any vertex array:
+	if (material->vao == 0) return nullptr;
+	//skip any drawables that don't contain any vertices:
+	if (pipeline.count == 0) return nullptr;
+	return material;
+}
 
 void Scene::load(std::string const &filename,
-	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+	std::function< void(Scene &, Transform *, InternedString) > const &on_drawable) {
 
 	std::ifstream file(filename, std::ios::binary);
 
+	//(entry layouts are in file_entries.hpp)
 	std::vector< char > names;
 	read_chunk(file, "str0", &names);
 
-	struct HierarchyEntry {
-		uint32_t parent;
-		uint32_t name_begin;
-		uint32_t name_end;
-		glm::vec3 position;
-		glm::quat rotation;
-		glm::vec3 scale;
-	};
-	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
 	std::vector< HierarchyEntry > hierarchy;
 	read_chunk(file, "xfh0", &hierarchy);
 
-	struct MeshEntry {
-		uint32_t transform;
-		uint32_t name_begin;
-		uint32_t name_end;
-	};
-	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
 	std::vector< MeshEntry > meshes;
 	read_chunk(file, "msh0", &meshes);
 
-	struct CameraEntry {
-		uint32_t transform;
-		char type[4]; //"pers" or "orth"
-		float data; //fov in degrees for 'pers', scale for 'orth'
-		float clip_near, clip_far;
-	};
-	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
 	std::vector< CameraEntry > loaded_cameras;
 	read_chunk(file, "cam0", &loaded_cameras);
 
-	struct LightEntry {
-		uint32_t transform;
-		char type;
-		glm::u8vec3 color;
-		float energy;
-		float distance;
-		float fov;
-	};
-	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
 	std::vector< LightEntry > loaded_lights;
 	read_chunk(file, "lmp0", &loaded_lights);
 
@@ -238,8 +503,7 @@ void Scene::load(std::string const &filename,
 	hierarchy_transforms.reserve(hierarchy.size());
 
 	for (auto const &h : hierarchy) {
-		transforms.emplace_back();
-		Transform *t = &transforms.back();
+		Transform *t = &transforms.emplace_back();
 		if (h.parent != -1U) {
 			if (h.parent >= hierarchy_transforms.size()) {
 				throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
@@ -248,7 +512,7 @@ void Scene::load(std::string const &filename,
 		}
 
 		if (h.name_begin <= h.name_end && h.name_end <= names.size()) {
-			t->name = std::string(names.begin() + h.name_begin, names.begin() + h.name_end);
+			t->name = InternedString(std::string_view(names.data() + h.name_begin, h.name_end - h.name_begin));
 		} else {
 				throw std::runtime_error("scene file '" + filename + "' contains hierarchy entry with invalid name indices");
 		}
@@ -257,6 +521,8 @@ void Scene::load(std::string const &filename,
 		t->rotation = h.rotation;
 		t->scale = h.scale;
 
+		transform_names.add(NameIndex::hash(t->name), transforms.index_of(t));
+
 		hierarchy_transforms.emplace_back(t);
 	}
 	assert(hierarchy_transforms.size() == hierarchy.size());
@@ -268,7 +534,7 @@ void Scene::load(std::string const &filename,
 		if (!(m.name_begin <= m.name_end && m.name_end <= names.size())) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid name indices");
 		}
-		std::string name = std::string(names.begin() + m.name_begin, names.begin() + m.name_end);
+		InternedString name(std::string_view(names.data() + m.name_begin, m.name_end - m.name_begin));
 
 		if (on_drawable) {
 			on_drawable(*this, hierarchy_transforms[m.transform], name);
@@ -284,11 +550,12 @@ void Scene::load(std::string const &filename,
 			std::cout << "Ignoring non-perspective camera (" + std::string(c.type, 4) + ") stored in file." << std::endl;
 			continue;
 		}
-		cameras.emplace_back(hierarchy_transforms[c.transform]);
-		Camera *camera = &cameras.back();
+		Camera *camera = &cameras.emplace_back(hierarchy_transforms[c.transform]);
 		camera->fovy = c.data / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
 		camera->near = c.clip_near;
 		//N.b. far plane is ignored because cameras use infinite perspective matrices.
+
+		camera_names.add(NameIndex::hash(camera->transform->name), cameras.index_of(camera));
 	}
 
 	for (auto const &l : loaded_lights) {
@@ -307,11 +574,12 @@ void Scene::load(std::string const &filename,
 			std::cout << "Ignoring unrecognized lamp type (" + std::string(&l.type, 1) + ") stored in file." << std::endl;
 			continue;
 		}
-		lights.emplace_back(hierarchy_transforms[l.transform]);
-		Light *light = &lights.back();
+		Light *light = &lights.emplace_back(hierarchy_transforms[l.transform]);
 		light->type = static_cast<Light::Type>(l.type);
 		light->energy = glm::vec3(l.color) / 255.0f * l.energy;
 		light->spot_fov = l.fov / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
+
+		light_names.add(NameIndex::hash(light->transform->name), lights.index_of(light));
 	}
 
 	//load any extra that a subclass wants:
@@ -327,7 +595,7 @@ void Scene::load(std::string const &filename,
 
 //-------------------------
 
-Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, InternedString) > const &on_drawable) {
 	load(filename, on_drawable);
 }
 
@@ -340,51 +608,40 @@ Scene &Scene::operator=(Scene const &other) {
 	return *this;
 }
 
-void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
-
-	std::unordered_map< Transform const *, Transform * > t2t_temp;
-	std::unordered_map< Transform const *, Transform * > &transform_to_transform = *(transform_map_ ? transform_map_ : &t2t_temp);
-
-	transform_to_transform.clear();
+void Scene::set(Scene const &other) {
+	if (&other == this) return;
 
-	//null transform maps to itself:
-	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
-
-	//Copy transforms and store mapping:
-	transforms.clear();
-	for (auto const &t : other.transforms) {
-		transforms.emplace_back();
-		transforms.back().name = t.name;
-		transforms.back().position = t.position;
-		transforms.back().rotation = t.rotation;
-		transforms.back().scale = t.scale;
-		transforms.back().parent = t.parent; //will update later
-
-		//store mapping between transforms old and new:
-		auto ret = transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
-		assert(ret.second);
-	}
+	//Copy transforms, keeping each at the same index as in other:
+	transforms.set(other.transforms);
 
 	//update transform parents:
 	for (auto &t : transforms) {
-		t.parent = transform_to_transform.at(t.parent);
+		t.parent = transforms.translate(other.transforms, t.parent);
 	}
 
+	//share other's materials (drawables refer to them by index, so indices stay valid):
+	materials = other.materials;
+
 	//copy other's drawables, updating transform pointers:
-	drawables = other.drawables;
+	drawables.set(other.drawables);
 	for (auto &d : drawables) {
-		d.transform = transform_to_transform.at(d.transform);
+		d.transform = transforms.translate(other.transforms, d.transform);
 	}
 
 	//copy other's cameras, updating transform pointers:
-	cameras = other.cameras;
+	cameras.set(other.cameras);
 	for (auto &c : cameras) {
-		c.transform = transform_to_transform.at(c.transform);
+		c.transform = transforms.translate(other.transforms, c.transform);
 	}
 
 	//copy other's lights, updating transform pointers:
-	lights = other.lights;
+	lights.set(other.lights);
 	for (auto &l : lights) {
-		l.transform = transform_to_transform.at(l.transform);
+		l.transform = transforms.translate(other.transforms, l.transform);
 	}
+
+	//indices are the same in the copy, so name indices can be copied as-is:
+	transform_names = other.transform_names;
+	camera_names = other.camera_names;
+	light_names = other.light_names;
 }
@@ -11,21 +11,21 @@
  */
 
 #include "GL.hpp"
+#include "ChunkedPool.hpp"
+#include "InternedString.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
-#include <list>
 #include <memory>
 #include <functional>
 #include <string>
 #include <vector>
-#include <unordered_map>
 
 struct Scene {
 	struct Transform {
 		//Transform names are useful for debugging and looking up locations in a loaded scene:
-		std::string name;
+		InternedString name;
 
 		//The core function of a transform is to store a transformation in the world:
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -44,16 +44,47 @@ struct Scene {
 		glm::mat4x3 make_local_from_world() const;
 
 		//since hierarchy is tracked through pointers, copy-constructing a transform  is not advised:
+		// (Scene::set copies transforms and then fixes up their parent pointers)
 		Transform(Transform const &) = delete;
 		//if we delete some constructors, we need to let the compiler know that the default constructor is still okay:
 		Transform() = default;
 	};
 
+	//A 'Material' holds everything needed to run the OpenGL pipeline, other than which vertices to draw:
+	// (materials are shared between drawables -- and between copies of a scene -- through Scene::materials)
+	struct Material {
+		GLuint program = 0; //shader program; passed to glUseProgram (if zero, drawing is skipped)
+
+		//attributes:
+		GLuint vao = 0; //attrib->buffer mapping; passed to glBindVertexArray
+
+		//uniforms:
+		GLuint CLIP_FROM_OBJECT_mat4 = -1U; //uniform location for object to clip space matrix
+		GLuint LIGHT_FROM_OBJECT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
+		GLuint LIGHT_FROM_NORMAL_mat3 = -1U; //uniform location for normal to light space (== world space) matrix
+		//...or, if the program declares Scene::ObjectBlockGLSL, set this instead to get all three matrices from a uniform buffer:
+		// (one buffer is filled for all the objects in a submit(), so there are no glUniform* calls per object)
+		bool object_block = false;
+
+		std::function< void() > set_uniforms; //(optional) function to set any other useful uniforms
+
+		//texture objects to bind for the first TextureCount textures:
+		enum : uint32_t { TextureCount = 4 };
+		struct TextureInfo {
+			GLuint texture = 0;
+			GLenum target = GL_TEXTURE_2D;
+		} textures[TextureCount];
+	};
+
 	struct Drawable {
 		//a 'Drawable' attaches attribute data to a transform:
+		// (it is a small plain record; how it is drawn is described by materials it refers to by index)
 		Drawable(Transform *transform_) : transform(transform_) { assert(transform); }
 		Transform * transform;
 
+		//static drawables never move relative to the world, so they may be merged with others at load time:
+		// (see StaticBatcher.hpp)
+		bool is_static = false;
 
 		//Each drawable contains pipeline information for...
 		enum PipelineType : uint32_t {
@@ -61,32 +92,40 @@ struct Scene {
 			PipelineTypeShadow = 1, //...drawing into a shadow map
 			PipelineTypes //count of pipeline types
 		};
-		//Contains all the data needed to run the OpenGL pipeline:
+		//Which material to draw with and which vertices to draw:
 		struct Pipeline {
-			GLuint program = 0; //shader program; passed to glUseProgram (if zero, drawing is skipped)
-
-			//attributes:
-			GLuint vao = 0; //attrib->buffer mapping; passed to glBindVertexArray
-
+			uint32_t material = NoMaterial; //index into Scene::materials (if NoMaterial, drawing is skipped)
 			GLenum type = GL_TRIANGLES; //what sort of primitive to draw; passed to glDrawArrays
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
+		} pipelines[PipelineTypes];
 
-			//uniforms:
-			GLuint CLIP_FROM_OBJECT_mat4 = -1U; //uniform location for object to clip space matrix
-			GLuint LIGHT_FROM_OBJECT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
-			GLuint LIGHT_FROM_NORMAL_mat3 = -1U; //uniform location for normal to light space (== world space) matrix
-
-			std::function< void() > set_uniforms; //(optional) function to set any other useful uniforms
+		//Coarser levels of detail, picked each pass from the drawable's projected size (see Scene::record):
+		// a level's vertex range replaces the start/count of every pipeline, so all pipelines must draw the same mesh.
+		enum : uint32_t { MaxLODs = 3 };
+		struct LOD {
+			uint32_t count = 0; //coarser levels available (if zero, 'pipelines' are always drawn as-is)
+			struct Range {
+				GLuint start = 0;
+				GLuint count = 0;
+			} ranges[MaxLODs]; //ranges[0] is the first coarser level, and so on
+			glm::vec3 center = glm::vec3(0.0f); //bounding sphere (object space)
+			float radius = 0.0f;
+		} lod;
+		//the full-detail vertices are drawn while the bounding sphere's diameter covers at least this fraction
+		// of the view's height; each coarser level takes over when it covers half as much as the one before:
+		static constexpr float LODFullSize = 0.25f;
+	};
+	enum : uint32_t { NoMaterial = -1U };
 
-			//texture objects to bind for the first TextureCount textures:
-			enum : uint32_t { TextureCount = 4 };
-			struct TextureInfo {
-				GLuint texture = 0;
-				GLenum target = GL_TEXTURE_2D;
-			} textures[TextureCount];
-		} pipelines[PipelineTypes];
+	//Depth conventions supported by the make_projection() functions below:
+	enum DepthConvention : uint8_t {
+		DepthStandard, //near -> -1, far -> 1 (the OpenGL default; use glDepthFunc(GL_LESS), glClearDepth(1.0))
+		DepthReversed, //near -> 1, far -> -1 (use glDepthFunc(GL_GREATER), glClearDepth(0.0))
+		DepthReversedZeroToOne, //near -> 1, far -> 0 (as above, plus glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE))
 	};
+	//NOTE: reversed-Z only really pays off with a floating point depth buffer and [0,1] clip depth,
+	// since then the float exponent concentrates precision at large distances, where the projection loses it.
 
 	struct Camera {
 		//a 'Camera' attaches camera data to a transform:
@@ -98,6 +137,7 @@ struct Scene {
 		float fovy = glm::radians(60.0f); //vertical fov (in radians)
 		float aspect = 1.0f; //x / y
 		float near = 0.01f; //near plane
+		DepthConvention depth = DepthStandard; //how depth is mapped to clip space
 		//computed from the above:
 		glm::mat4 make_projection() const;
 	};
@@ -125,16 +165,75 @@ struct Scene {
 		//near and far planes for shadow maps: (NOTE: NOT loaded from scene files!)
 		float clip_start = 0.1f;
 		float clip_end = 100.0f;
+		DepthConvention depth = DepthStandard; //how depth is mapped to clip space
 
 		//computed from the above: (only for spotlights!)
 		glm::mat4 make_projection() const;
 	};
 
 	//Scenes, of course, may have many of the above objects:
-	std::list< Transform > transforms;
-	std::list< Drawable > drawables;
-	std::list< Camera > cameras;
-	std::list< Light > lights;
+	// (they live in ChunkedPools, which allocate and free in blocks, keep pointers stable, and let copies fix up pointers by index)
+	ChunkedPool< Transform > transforms;
+	ChunkedPool< Drawable > drawables;
+	ChunkedPool< Camera > cameras;
+	ChunkedPool< Light > lights;
+
+	//...and the materials drawables refer to:
+	std::vector< std::shared_ptr< Material > > materials;
+	//add a material (or share one from elsewhere); returns its index:
+	uint32_t add_material(std::shared_ptr< Material > const &material);
+	uint32_t add_material(Material const &material) { return add_material(std::make_shared< Material >(material)); }
+	//the drawable's material for a pipeline type, or nullptr if it won't be drawn:
+	// (same skip conditions as draw(): no material, no program, no vertex array, or no vertices)
+	Material const *get_material(Drawable const &drawable, Drawable::PipelineType pipeline_type) const;
+
+	//Finding things by name:
+	// (cameras and lights go by the names of their transforms)
+	//returns nullptr if nothing has the name; if several things do, returns the one with the lowest pool index:
+	// (that's the first one added, unless elements have been erased -- pools reuse erased slots, so later additions can come first)
+	Transform *find_transform(InternedString name);
+	Camera *find_camera(InternedString name);
+	Light *find_light(InternedString name);
+	//...every match, in pool index order:
+	std::vector< Transform * > find_transforms(InternedString name);
+	std::vector< Camera * > find_cameras(InternedString name);
+	std::vector< Light * > find_lights(InternedString name);
+	//(for convenience, the same functions also take text, which is looked up without being interned)
+	Transform *find_transform(std::string_view name) { return find_transform(InternedString::find(name)); }
+	Camera *find_camera(std::string_view name) { return find_camera(InternedString::find(name)); }
+	Light *find_light(std::string_view name) { return find_light(InternedString::find(name)); }
+	std::vector< Transform * > find_transforms(std::string_view name) { return find_transforms(InternedString::find(name)); }
+	std::vector< Camera * > find_cameras(std::string_view name) { return find_cameras(InternedString::find(name)); }
+	std::vector< Light * > find_lights(std::string_view name) { return find_lights(InternedString::find(name)); }
+
+	//A NameIndex is a hash table from name hashes to pool indices:
+	// (it stores no names -- candidates are checked against the names in the pool -- so it is cheap to copy)
+	struct NameIndex {
+		struct Entry {
+			uint32_t hash = 0;
+			uint32_t index = Empty;
+		};
+		enum : uint32_t { Empty = -1U };
+		std::vector< Entry > table; //open addressing with linear probing; size is zero or a power of two
+		uint32_t count = 0;
+
+		static uint32_t hash(InternedString name) { return name.id * 0x9E3779B1u; } //(spreads consecutive ids over the table)
+		void clear();
+		void add(uint32_t hash, uint32_t index);
+		//call fn(index) for every entry with a given hash:
+		template< typename F >
+		void find(uint32_t hash, F const &fn) const {
+			if (table.empty()) return;
+			uint32_t mask = uint32_t(table.size() - 1);
+			for (uint32_t i = hash & mask; table[i].index != Empty; i = (i + 1) & mask) {
+				if (table[i].hash == hash) fn(table[i].index);
+			}
+		}
+	};
+	//name -> index in 'transforms', 'cameras', and 'lights':
+	// load() and set() keep these up to date; if you add, rename, or remove transforms, cameras, or lights yourself, call index_names()
+	NameIndex transform_names, camera_names, light_names;
+	void index_names();
 
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
 	void draw(Camera const &camera, Drawable::PipelineType pipeline_type = Drawable::PipelineTypeDefault) const;
@@ -144,11 +243,66 @@ struct Scene {
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
 	void draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world = glm::mat4x3(1.0f), Drawable::PipelineType pipeline_type = Drawable::PipelineTypeDefault) const;
 
+	//Per-object data for materials with 'object_block' set, laid out as in ObjectBlockGLSL:
+	// (std140 pads each matrix column to a vec4)
+	struct ObjectBlock {
+		glm::mat4 clip_from_object;
+		glm::vec4 light_from_object[4]; //mat4x3
+		glm::vec4 light_from_normal[3]; //mat3
+	};
+	static_assert(sizeof(ObjectBlock) == 64 + 4*16 + 3*16, "ObjectBlock matches std140 layout.");
+	//programs using the object block should include this in their vertex shader, and bind the block to ObjectBlockBinding:
+	static constexpr char const *ObjectBlockGLSL =
+		"layout(std140) uniform Object {\n"
+		"	mat4 CLIP_FROM_OBJECT;\n"
+		"	mat4x3 LIGHT_FROM_OBJECT;\n"
+		"	mat3 LIGHT_FROM_NORMAL;\n"
+		"};\n";
+	enum : GLuint { ObjectBlockBinding = 0 }; //uniform buffer binding point used for the object block
+
+	//Drawing happens in two steps, which can also be called separately: (draw == record + submit)
+	// 'record' does the CPU work -- computing each drawable's matrices into a DrawList -- and makes no GL calls,
+	//  so it can run on any thread (e.g., a simulation thread, while the GL thread submits an earlier frame).
+	//  Large scenes are split into chunks that are recorded in parallel (using JobSystem::shared()).
+	//  Several lists can be recorded at once, as long as the scene isn't being modified.
+	// 'submit' walks a DrawList and makes the GL calls, so it must run on the thread that owns the GL context.
+	//NOTE: DrawList items point to materials; don't remove or change materials until lists that reference them are submitted.
+	struct DrawList {
+		struct Item {
+			Material const *material = nullptr;
+			Drawable::Pipeline pipeline; //(vertices to draw, at the level of detail picked)
+			glm::mat4 clip_from_object = glm::mat4(1.0f); //(only computed if material uses it)
+			glm::mat4x3 light_from_object = glm::mat4x3(1.0f);
+			glm::mat3 light_from_normal = glm::mat3(1.0f); //(only computed if material uses it)
+		};
+		std::vector< Item > items;
+		uint32_t culled = 0; //drawables left out (reported in RenderStats when submitted)
+
+		//-- internals ---
+		enum : uint32_t { RecordChunk = 64 }; //drawables per parallel job
+		std::vector< Drawable const * > drawables; //drawables being recorded (kept to avoid reallocating)
+	};
+	//record replaces the contents of 'list':
+	// 'lod_bias' is added to the level of detail picked for each drawable (so positive values draw coarser levels sooner);
+	// passes that must cover exactly the same pixels (like a depth pre-pass and the pass it is for) need the same bias.
+	void record(Camera const &camera, Drawable::PipelineType pipeline_type, DrawList *list, float lod_bias = 0.0f) const;
+	void record(Light const &light, Drawable::PipelineType pipeline_type, DrawList *list, float lod_bias = 0.0f) const;
+	void record(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world, Drawable::PipelineType pipeline_type, DrawList *list, float lod_bias = 0.0f) const;
+	static void submit(DrawList const &list);
+
+	//rough measure of how much work a pass over the scene with a given pipeline type submits:
+	// (useful for deciding whether, e.g., an extra depth pre-pass will pay for itself)
+	struct Complexity {
+		uint32_t drawables = 0; //drawables that would be drawn
+		uint32_t vertices = 0; //total vertices those drawables submit
+	};
+	Complexity complexity(Drawable::PipelineType pipeline_type = Drawable::PipelineTypeDefault) const;
+
 	//add transforms/objects/cameras from a scene file to this scene:
-	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
+	// the 'on_drawable' callback gives your code a chance to look up mesh data (by the mesh name passed to it) and make Drawables:
 	// throws on file format errors
 	void load(std::string const &filename,
-		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
+		std::function< void(Scene &, Transform *, InternedString) > const &on_drawable = nullptr
 	);
 
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
@@ -159,11 +313,13 @@ struct Scene {
 	Scene() = default;
 
 	//load a scene:
-	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable);
+	Scene(std::string const &filename, std::function< void(Scene &, Transform *, InternedString) > const &on_drawable);
 
-	//copy a scene (with proper pointer fixup):
+	//copy a scene (with proper pointer fixup; materials are shared with the original):
 	Scene(Scene const &); //...as a constructor
 	Scene &operator=(Scene const &); //...as scene = scene
-	//... as a set() function that optionally returns the transform->transform mapping:
-	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
+	//... as a set() function:
+	// each transform in the copy has the same index as in the original, so to find the copy of 'Transform *t':
+	//  copy.transforms[other.transforms.index_of(t)]  (or copy.transforms.translate(other.transforms, t))
+	void set(Scene const &);
 };
@@ -7,9 +7,17 @@
 #include "gl_errors.hpp" //helper for dumpping OpenGL error messages
 #include "gl_check_fb.hpp" //helper for checking currently bound OpenGL framebuffer
 #include "gl_compile_program.hpp" //helper to compile opengl shader programs
+#include "gl_extensions.hpp" //optional post-3.3 OpenGL features
 #include "load_save_png.hpp"
 #include "ShadowedColorTextureProgram.hpp"
 #include "DepthOnlyProgram.hpp"
+#include "PostProcessPrograms.hpp"
+#include "RenderTargetPool.hpp"
+#include "JobSystem.hpp"
+#include "GPURingBuffer.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "StaticBatcher.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -17,11 +25,16 @@
 #include <fstream>
 #include <map>
 #include <cstddef>
+#include <cstring>
 #include <random>
+#include <algorithm>
+#include <cmath>
 
+std::string scene_name = "vignette";
 
 Load< MeshBuffer > meshes(LoadTagDefault, [](){
-	return new MeshBuffer(data_path("vignette.pnct"));
+	//(keep vertices around so static objects can be merged into batches)
+	return new MeshBuffer(data_path(scene_name + ".pnct"), true);
 });
 
 Load< GLuint > meshes_for_shadowed_color_texture_program(LoadTagDefault, [](){
@@ -76,6 +89,10 @@ Load< GLuint > white_tex(LoadTagDefault, [](){
 });
 
 
+//merged vertices for static batches (see StaticBatcher):
+MeshBuffer const *static_batches = nullptr;
+glm::vec3 static_min = glm::vec3(0.0f), static_max = glm::vec3(0.0f); //(bounds of static_batches)
+
 Scene::Camera *camera = nullptr;
 Scene::Transform *spot_parent_transform = nullptr;
 Scene::Light *spot = nullptr;
@@ -83,30 +100,36 @@ Scene::Light *spot = nullptr;
 Load< Scene > scene(LoadTagDefault, [](){
 	Scene *ret = new Scene;
 
-	//pre-build some program info (material) blocks to assign to each object:
-	Scene::Drawable::Pipeline texture_pipeline;
-	texture_pipeline = shadowed_color_texture_program_pipeline; //start with the ready-made pipeline from ShadowedColorTextureProgram.cpp
-	texture_pipeline.vao = *meshes_for_shadowed_color_texture_program;
+	//build the materials objects will share:
+	Scene::Material texture_material = shadowed_color_texture_program_material; //start with the ready-made material from ShadowedColorTextureProgram.cpp
+	texture_material.vao = *meshes_for_shadowed_color_texture_program;
+
+	texture_material.textures[0] = Scene::Material::TextureInfo{ .texture = *wood_tex };
+	uint32_t wood_material = ret->add_material(texture_material);
+	texture_material.textures[0] = Scene::Material::TextureInfo{ .texture = *marble_tex };
+	uint32_t marble_material = ret->add_material(texture_material);
+	texture_material.textures[0] = Scene::Material::TextureInfo{ .texture = *white_tex };
+	uint32_t white_material = ret->add_material(texture_material);
 
-	Scene::Drawable::Pipeline depth_pipeline;
-	depth_pipeline = depth_only_program_pipeline; //start with the ready-made pipeline from DepthProgram.cpp
-	depth_pipeline.vao = *meshes_for_depth_only_program;
+	Scene::Material depth_material = depth_only_program_material; //start with the ready-made material from DepthOnlyProgram.cpp
+	depth_material.vao = *meshes_for_depth_only_program;
+	uint32_t depth_only_material = ret->add_material(depth_material);
 
 
 	//load transform hierarchy:
-	ret->load(data_path("vignette.scene"), [&](Scene &s, Scene::Transform *t, std::string const &m){
+	InternedString platform("Platform"), pedestal("Pedestal");
+	ret->load(data_path(scene_name + ".scene"), [&](Scene &s, Scene::Transform *t, InternedString m){
 		Scene::Drawable &obj = s.drawables.emplace_back(t);
 
-		obj.pipelines[Scene::Drawable::PipelineTypeDefault] = texture_pipeline;
-		if (t->name == "Platform") {
-			obj.pipelines[Scene::Drawable::PipelineTypeDefault].textures[0] = Scene::Drawable::Pipeline::TextureInfo{ .texture = *wood_tex };
-		} else if (t->name == "Pedestal") {
-			obj.pipelines[Scene::Drawable::PipelineTypeDefault].textures[0] = Scene::Drawable::Pipeline::TextureInfo{ .texture = *marble_tex };
+		if (t->name == platform) {
+			obj.pipelines[Scene::Drawable::PipelineTypeDefault].material = wood_material;
+		} else if (t->name == pedestal) {
+			obj.pipelines[Scene::Drawable::PipelineTypeDefault].material = marble_material;
 		} else {
-			obj.pipelines[Scene::Drawable::PipelineTypeDefault].textures[0] = Scene::Drawable::Pipeline::TextureInfo{ .texture = *white_tex };
+			obj.pipelines[Scene::Drawable::PipelineTypeDefault].material = white_material;
 		}
 
-		obj.pipelines[Scene::Drawable::PipelineTypeShadow] = depth_pipeline;
+		obj.pipelines[Scene::Drawable::PipelineTypeShadow].material = depth_only_material;
 
 		Mesh const &mesh = meshes->lookup(m);
 		obj.pipelines[Scene::Drawable::PipelineTypeDefault].start = mesh.start;
@@ -114,44 +137,113 @@ Load< Scene > scene(LoadTagDefault, [](){
 
 		obj.pipelines[Scene::Drawable::PipelineTypeShadow].start = mesh.start;
 		obj.pipelines[Scene::Drawable::PipelineTypeShadow].count = mesh.count;
-	});
 
-	//look up spot parent transform (for spin interaction):
-	for (Scene::Transform &t : ret->transforms) {
-		if (t.name == "SpotParent") {
-			if (spot_parent_transform) throw std::runtime_error("Multiple 'SpotParent' transforms in scene.");
-			spot_parent_transform = &t;
+		//coarser levels of detail, if the mesh file has them (see simplify-mesh.cpp):
+		obj.lod.count = std::min(mesh.lod_count, uint32_t(Scene::Drawable::MaxLODs));
+		for (uint32_t l = 0; l < obj.lod.count; ++l) {
+			obj.lod.ranges[l].start = mesh.lods[l].start;
+			obj.lod.ranges[l].count = mesh.lods[l].count;
 		}
+		obj.lod.center = mesh.center;
+		obj.lod.radius = mesh.radius;
+	});
 
-	}
-	if (!spot_parent_transform) throw std::runtime_error("No 'SpotParent' transform in scene.");
+	//look up spot parent transform (for spin interaction):
+	std::vector< Scene::Transform * > spot_parents = ret->find_transforms("SpotParent");
+	if (spot_parents.size() > 1) throw std::runtime_error("Multiple 'SpotParent' transforms in scene.");
+	if (spot_parents.empty()) throw std::runtime_error("No 'SpotParent' transform in scene.");
+	spot_parent_transform = spot_parents[0];
 
 	//look up the camera:
-	for (Scene::Camera &c : ret->cameras) {
-		if (c.transform->name == "Camera") {
-			if (camera) throw std::runtime_error("Multiple 'Camera' objects in scene.");
-			camera = &c;
-		}
-	}
-	if (!camera) throw std::runtime_error("No 'Camera' camera in scene.");
+	std::vector< Scene::Camera * > cameras = ret->find_cameras("Camera");
+	if (cameras.size() > 1) throw std::runtime_error("Multiple 'Camera' objects in scene.");
+	if (cameras.empty()) throw std::runtime_error("No 'Camera' camera in scene.");
+	camera = cameras[0];
 
 	//look up the spotlight:
-	for (Scene::Light &l : ret->lights) {
-		if (l.transform->name == "Spot") {
-			if (spot) throw std::runtime_error("Multiple 'Spot' objects in scene.");
-			if (l.type != Scene::Light::Spot) throw std::runtime_error("Lamp 'Spot' is not a spotlight.");
-			spot = &l;
+	std::vector< Scene::Light * > spots = ret->find_lights("Spot");
+	if (spots.size() > 1) throw std::runtime_error("Multiple 'Spot' objects in scene.");
+	if (spots.empty()) throw std::runtime_error("No 'Spot' spotlight in scene.");
+	if (spots[0]->type != Scene::Light::Spot) throw std::runtime_error("Lamp 'Spot' is not a spotlight.");
+	spot = spots[0];
+
+	//everything except the spotlight's rig stays put, so can be merged into static batches:
+	for (Scene::Drawable &d : ret->drawables) {
+		d.is_static = true;
+		for (Scene::Transform *t = d.transform; t; t = t->parent) {
+			if (t == spot_parent_transform) d.is_static = false;
 		}
 	}
-	if (!spot) throw std::runtime_error("No 'Spot' spotlight in scene.");
+	StaticBatcher::Result batched = StaticBatcher::batch(*ret, *meshes);
+	static_batches = batched.buffer;
+	static_min = batched.min;
+	static_max = batched.max;
+	std::cout << "Static batching: " << batched.draws_before << " draws -> " << batched.draws_after << " draws (" << batched.batches << " batches)." << std::endl;
 
 	return ret;
 });
 
 ShadowMapMode::ShadowMapMode() {
+	previous_camera_position = camera->transform->position;
+
+	//the camera path orbits the z axis, aimed at the point on the axis nearest the camera's starting view direction:
+	camera_path_start = camera->transform->position;
+	glm::vec3 forward = -camera->transform->make_parent_from_local()[2];
+	float s = 0.0f;
+	if (glm::dot(glm::vec2(forward), glm::vec2(forward)) > 1e-6f) {
+		s = std::max(0.0f, -glm::dot(glm::vec2(camera_path_start), glm::vec2(forward)) / glm::dot(glm::vec2(forward), glm::vec2(forward)));
+	}
+	camera_path_target = glm::vec3(0.0f, 0.0f, camera_path_start.z + s * forward.z);
+}
+
+void ShadowMapMode::restart_camera_path() {
+	camera_path_time = 0.0f;
+	spot_spin = 0.0f;
+	camera->transform->position = camera_path_start;
+	previous_camera_position = camera_path_start;
 }
 
 ShadowMapMode::~ShadowMapMode() {
+	if (scene_copies != 1) set_scene_copies(1);
+}
+
+void ShadowMapMode::set_scene_copies(uint32_t copies) {
+	//(Load<> only hands out a const scene, but -- as with spinning the spotlight -- the scene is this mode's to change)
+	Scene &s = const_cast< Scene & >(*scene);
+
+	for (Scene::Drawable *d : copy_drawables) s.drawables.erase(d);
+	for (Scene::Transform *t : copy_transforms) s.transforms.erase(t);
+	copy_drawables.clear();
+	copy_transforms.clear();
+
+	scene_copies = std::max(1U, copies);
+	if (scene_copies == 1) return;
+
+	//copy static drawables attached directly to the world (e.g., batches made by StaticBatcher):
+	std::vector< Scene::Drawable const * > originals;
+	for (Scene::Drawable const &d : s.drawables) {
+		if (d.is_static && d.transform->parent == nullptr) originals.emplace_back(&d);
+	}
+
+	//copies go in a square grid, spaced a bit more than the scenery's size:
+	glm::vec3 size = glm::max(glm::vec3(1.0f), static_max - static_min);
+	float spacing = 1.25f * std::max(size.x, size.y);
+	uint32_t side = uint32_t(std::ceil(std::sqrt(float(scene_copies))));
+
+	for (uint32_t c = 1; c < scene_copies; ++c) {
+		glm::vec3 offset = glm::vec3(float(c % side) * spacing, float(c / side) * spacing, 0.0f);
+		for (Scene::Drawable const *original : originals) {
+			Scene::Transform &transform = s.transforms.emplace_back();
+			transform.position = original->transform->position + offset;
+			transform.rotation = original->transform->rotation;
+			transform.scale = original->transform->scale;
+			copy_transforms.emplace_back(&transform);
+
+			Scene::Drawable &drawable = s.drawables.emplace_back(*original);
+			drawable.transform = &transform;
+			copy_drawables.emplace_back(&drawable);
+		}
+	}
 }
 
 bool ShadowMapMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
@@ -176,6 +268,61 @@ bool ShadowMapMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_
 			down.downs += 1;
 			down.pressed = true;
 			return true;
+		} else if (evt.key.key == SDLK_P) {
+			if (depth_prepass == PrepassOff) depth_prepass = PrepassOn;
+			else if (depth_prepass == PrepassOn) depth_prepass = PrepassAuto;
+			else depth_prepass = PrepassOff;
+			std::cout << "Depth pre-pass " << (depth_prepass == PrepassOff ? "off" : depth_prepass == PrepassOn ? "on" : "auto") << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_I) {
+			profiler.print_stats(std::cout);
+			RenderStats::Counts const &last = render_stats.last_frame;
+			std::cout << "Last frame: " << last.draws << " draws, " << last.vertices << " vertices, " << last.culled << " culled, "
+				<< last.program_binds << " program / " << last.vao_binds << " VAO / " << last.texture_binds << " texture binds, "
+				<< last.uniform_uploads << " uniform uploads, " << last.buffer_bytes << " buffer bytes." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_O) {
+			if (!profiler.tracing) {
+				std::cout << "Capturing profile trace (press 'O' again to save)." << std::endl;
+				profiler.start_trace();
+			} else {
+				profiler.stop_trace("profile-trace.json");
+			}
+			return true;
+		} else if (evt.key.key == SDLK_T) {
+			tone_map = !tone_map;
+			std::cout << "Tone mapping " << (tone_map ? "on" : "off") << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_F) {
+			fxaa = !fxaa;
+			std::cout << "FXAA " << (fxaa ? "on" : "off") << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_V) {
+			vignette = !vignette;
+			std::cout << "Vignette " << (vignette ? "on" : "off") << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_MINUS || evt.key.key == SDLK_EQUALS) {
+			if (dynamic_resolution) {
+				dynamic_resolution = false;
+				std::cout << "Dynamic resolution off." << std::endl;
+			}
+			render_scale = glm::clamp(render_scale + (evt.key.key == SDLK_MINUS ? -0.125f : 0.125f), 0.25f, max_render_scale);
+			std::cout << "Render scale " << render_scale << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_R) {
+			dynamic_resolution = !dynamic_resolution;
+			if (dynamic_resolution) resolution.scale = render_scale; //start from the current scale
+			std::cout << "Dynamic resolution " << (dynamic_resolution ? "on" : "off") << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_Z) {
+			reversed_z = !reversed_z;
+			std::cout << "Reversed-Z depth " << (reversed_z ? "on" : "off") << "." << std::endl;
+			return true;
+		} else if (evt.key.key == SDLK_L) {
+			//(a very negative bias always picks full detail)
+			lod_bias = (lod_bias > -100.0f ? -1000.0f : 0.0f);
+			std::cout << "Levels of detail " << (lod_bias > -100.0f ? "on" : "off") << "." << std::endl;
+			return true;
 		}
 	} else if (evt.type == SDL_EVENT_KEY_UP) {
 		if (evt.key.key == SDLK_A) {
@@ -221,6 +368,26 @@ bool ShadowMapMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_
 }
 
 void ShadowMapMode::update(float elapsed) {
+	//remember where the camera was, for interpolating in draw:
+	previous_camera_position = camera->transform->position;
+
+	if (camera_path) {
+		//follow the scripted path instead of input:
+		camera_path_time += elapsed;
+		float angle = 2.0f * 3.1415926f * (camera_path_time / camera_path_duration);
+		float radius = glm::length(glm::vec2(camera_path_start));
+		float start_angle = std::atan2(camera_path_start.y, camera_path_start.x);
+		glm::vec3 position = glm::vec3(radius * std::cos(start_angle + angle), radius * std::sin(start_angle + angle), camera_path_start.z);
+
+		glm::vec3 forward = glm::normalize(camera_path_target - position);
+		glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 0.0f, 1.0f)));
+		glm::vec3 up = glm::cross(right, forward);
+		camera->transform->position = position;
+		camera->transform->rotation = glm::quat_cast(glm::mat3(right, up, -forward));
+
+		spot_spin = 2.0f * angle;
+	}
+
 	//update spot light parent rotation based on spin value:
 	spot_parent_transform->rotation = glm::angleAxis(spot_spin, glm::vec3(0.0f, 0.0f, 1.0f));
 
@@ -242,7 +409,7 @@ void ShadowMapMode::update(float elapsed) {
 		//glm::vec3 up = frame[1];
 		glm::vec3 frame_forward = -frame[2];
 
-		camera->transform->position += move.x * frame_right + move.y * frame_forward;
+		if (!camera_path) camera->transform->position += move.x * frame_right + move.y * frame_forward;
 	}
 	
 	//reset button press counters:
@@ -253,13 +420,95 @@ void ShadowMapMode::update(float elapsed) {
 
 }
 
+void ShadowMapMode::record(glm::uvec2 const &drawable_size) {
+	ProfileScope scope("ShadowMapMode::record");
+
+	Frame &frame = frames[1 - draw_frame];
+
+	//when updating with a fixed timestep, record the camera partway between its previous and current positions:
+	glm::vec3 camera_position = camera->transform->position;
+	camera->transform->position = glm::mix(previous_camera_position, camera_position, draw_alpha);
+
+	//Pick a depth convention for this frame:
+	frame.depth_convention = Scene::DepthStandard;
+	if (reversed_z) {
+		//[0,1] clip depth is needed to get the full benefit of reversed-Z, but isn't available everywhere:
+		frame.depth_convention = (gl_ext.clip_control ? Scene::DepthReversedZeroToOne : Scene::DepthReversed);
+	}
+	camera->depth = frame.depth_convention;
+	spot->depth = frame.depth_convention;
+
+	//(the scene may be drawn at a different internal resolution, but it keeps the window's aspect ratio)
+	camera->aspect = drawable_size.x / float(drawable_size.y);
+
+	//the passes don't depend on each other, so record them all at once:
+	JobSystem &jobs = JobSystem::shared();
+	JobSystem::Group passes;
+
+	jobs.run(&passes, [&](){
+		scene->record(*spot, Scene::Drawable::PipelineTypeShadow, &frame.shadow, lod_bias + shadow_lod_bias);
+	});
+
+	//the pre-pass draws the shadow (depth-only) pipelines from the camera:
+	if (depth_prepass != PrepassOff) {
+		jobs.run(&passes, [&](){
+			scene->record(*camera, Scene::Drawable::PipelineTypeShadow, &frame.prepass, lod_bias);
+		});
+	} else {
+		frame.prepass.items.clear();
+	}
+
+	scene->record(*camera, Scene::Drawable::PipelineTypeDefault, &frame.shaded, lod_bias);
+
+	jobs.wait(&passes);
+
+	auto complexity = [](Scene::DrawList const &list) {
+		Scene::Complexity ret;
+		for (auto const &item : list.items) {
+			ret.drawables += 1;
+			ret.vertices += item.pipeline.count;
+		}
+		return ret;
+	};
+	frame.shaded_complexity = complexity(frame.shaded);
+	frame.prepass_complexity = complexity(frame.prepass);
+
+	frame.spot_clip_from_world = spot->make_projection() * glm::mat4(spot->transform->make_local_from_world());
+	glm::mat4x3 world_from_spot = spot->transform->make_world_from_local();
+	frame.spot_position = world_from_spot[3];
+	frame.spot_direction = -world_from_spot[2];
+	frame.spot_fov = spot->spot_fov;
+
+	camera->transform->position = camera_position;
+}
+
+void ShadowMapMode::flip() {
+	draw_frame = 1 - draw_frame;
+}
+
+bool ShadowMapMode::use_depth_prepass(Frame const &frame, glm::uvec2 const &drawable_size) const {
+	if (frame.prepass.items.empty()) return false;
+	if (depth_prepass == PrepassOn) return true;
+	if (depth_prepass != PrepassAuto) return false;
+
+	//the pre-pass draws the shadow (depth-only) pipelines from the camera, so both passes need to be there:
+	Scene::Complexity const &shading = frame.shaded_complexity;
+	Scene::Complexity const &depth = frame.prepass_complexity;
+	if (depth.drawables < shading.drawables) return false;
+
+	float pixels = float(drawable_size.x) * float(drawable_size.y);
+	return shading.drawables >= prepass_min_drawables
+	    && float(depth.vertices) <= prepass_max_vertices_per_pixel * pixels;
+}
+
 //ShadowMapMode will render to some offscreen framebuffer(s).
 //This code allocates and resizes them as needed:
 struct Framebuffers {
 	glm::uvec2 size = glm::uvec2(0,0); //remember the size of the framebuffer
 
 	//This framebuffer is used for fullscreen effects:
-	GLuint color_tex = 0;
+	// (the scene is rendered here, at internal resolution, and then post-processed to the window)
+	GLuint color_tex = 0; //high dynamic range (float) color
 	GLuint depth_rb = 0;
 	GLuint fb = 0;
 
@@ -276,16 +525,16 @@ struct Framebuffers {
 
 			if (color_tex == 0) glGenTextures(1, &color_tex);
 			glBindTexture(GL_TEXTURE_2D, color_tex);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.x, size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.x, size.y, 0, GL_RGBA, GL_FLOAT, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 			glBindTexture(GL_TEXTURE_2D, 0);
 	
 			if (depth_rb == 0) glGenRenderbuffers(1, &depth_rb);
 			glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
-			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, size.x, size.y);
 			glBindRenderbuffer(GL_RENDERBUFFER, 0);
 	
 			if (fb == 0) glGenFramebuffers(1, &fb);
@@ -314,7 +563,8 @@ struct Framebuffers {
 
 			if (shadow_depth_tex == 0) glGenTextures(1, &shadow_depth_tex);
 			glBindTexture(GL_TEXTURE_2D, shadow_depth_tex);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, shadow_size.x, shadow_size.y, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
+			//float depth works with either depth convention, but is what makes reversed-Z worthwhile:
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, shadow_size.x, shadow_size.y, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -333,10 +583,52 @@ struct Framebuffers {
 	}
 } fbs;
 
+//Transient targets for post-processing passes:
+RenderTargetPool render_targets;
+
 void ShadowMapMode::draw(glm::uvec2 const &drawable_size) {
-	fbs.allocate(drawable_size, glm::uvec2(512, 512));
+	ProfileScope scope("ShadowMapMode::draw");
+
+	//GPU timings from earlier frames drive dynamic resolution:
+	if (frame_timer.poll(&gpu_ms)) {
+		gpu_ms_count += 1;
+		if (dynamic_resolution) {
+			resolution.max_scale = max_render_scale;
+			resolution.update(gpu_ms);
+			render_scale = resolution.scale;
+		}
+	}
+	frame_timer.begin();
+
+	//(everything about the scene comes from the recorded frame, since update might be running on another thread)
+	Frame const &frame = frames[draw_frame];
+
+	//the scene is rendered at an internal resolution that may differ from the window:
+	auto scaled_size = [&drawable_size](float scale) {
+		return glm::max(glm::uvec2(1), glm::uvec2(glm::round(scale * glm::vec2(drawable_size))));
+	};
+	//offscreen targets are allocated at the largest internal resolution, and the current one uses the lower left part:
+	glm::uvec2 max_size = scaled_size(max_render_scale);
+	glm::uvec2 internal_size = glm::min(max_size, scaled_size(render_scale));
+	glm::vec2 uv_scale = glm::vec2(internal_size) / glm::vec2(max_size);
+	glm::vec2 texel_size = 1.0f / glm::vec2(max_size);
+
+	fbs.allocate(max_size, glm::uvec2(512, 512));
+
+	//Use the depth convention the frame was recorded with:
+	Scene::DepthConvention depth_convention = frame.depth_convention;
+	if (gl_ext.clip_control) {
+		gl_ext.ClipControl(GL_LOWER_LEFT, depth_convention == Scene::DepthReversedZeroToOne ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	}
+
+	//with reversed-Z, larger depth values are closer:
+	GLenum depth_less = (depth_convention == Scene::DepthStandard ? GL_LESS : GL_GREATER);
+	glClearDepth(depth_convention == Scene::DepthStandard ? 1.0 : 0.0);
+	glDepthFunc(depth_less);
 
 	//Draw scene to shadow map for spotlight:
+	RenderStats::Counts pass_begin = render_stats.frame;
+	profiler.gpu_begin("shadow map");
 	glBindFramebuffer(GL_FRAMEBUFFER, fbs.shadow_fb);
 	glViewport(0,0,fbs.shadow_size.x, fbs.shadow_size.y);
 
@@ -349,20 +641,23 @@ void ShadowMapMode::draw(glm::uvec2 const &drawable_size) {
 	glCullFace(GL_FRONT);
 	glEnable(GL_CULL_FACE);
 
-	scene->draw(*spot, Scene::Drawable::PipelineTypeShadow);
+	Scene::submit(frame.shadow);
 
 	glDisable(GL_CULL_FACE);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	profiler.gpu_end();
+	shadow_pass_stats = render_stats.frame - pass_begin;
 
 	GL_ERRORS();
 
 
-	//----- draw scene to the window -----
+	//----- draw scene to the offscreen framebuffer -----
 
-	glViewport(0,0,drawable_size.x, drawable_size.y);
-
-	camera->aspect = drawable_size.x / float(drawable_size.y);
+	pass_begin = render_stats.frame;
+	profiler.gpu_begin("scene");
+	glBindFramebuffer(GL_FRAMEBUFFER, fbs.fb);
+	glViewport(0,0,internal_size.x, internal_size.y);
 
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -373,52 +668,175 @@ void ShadowMapMode::draw(glm::uvec2 const &drawable_size) {
 	glBlendEquation(GL_FUNC_ADD);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+	bool prepass = use_depth_prepass(frame, internal_size);
+	if (prepass) {
+		//fill the depth buffer using the depth-only pipelines:
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		Scene::submit(frame.prepass);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		//...and then only shade the fragments that ended up visible:
+		// (this relies on both programs declaring gl_Position as 'invariant')
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_EQUAL);
+	}
+
 	//set up light positions:
-	glUseProgram(shadowed_color_texture_program->program);
+	ShadowedColorTextureProgram::Lights lights;
 
 	//don't use distant directional light at all (color == 0):
-	glUniform3fv(shadowed_color_texture_program->sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, 0.0f)));
-	glUniform3fv(shadowed_color_texture_program->sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(0.0f, 0.0f,-1.0f))));
+	lights.sun_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	lights.sun_direction = glm::vec4(glm::normalize(glm::vec3(0.0f, 0.0f,-1.0f)), 0.0f);
 	//use hemisphere light for subtle ambient light:
-	glUniform3fv(shadowed_color_texture_program->sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.3f)));
-	glUniform3fv(shadowed_color_texture_program->sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, 1.0f)));
+	lights.sky_color = glm::vec4(0.2f, 0.2f, 0.3f, 0.0f);
+	lights.sky_direction = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+
+	//the bias pushes looked-up depths away from the light, which is toward smaller depths when using reversed-Z:
+	float bias = (depth_convention == Scene::DepthStandard ? shadow_bias : -shadow_bias);
+	//with [0,1] clip depth, clip z is already a depth map value:
+	float z_scale = (depth_convention == Scene::DepthReversedZeroToOne ? 1.0f : 0.5f);
+	float z_offset = (depth_convention == Scene::DepthReversedZeroToOne ? 0.0f : 0.5f);
 
 	glm::mat4 spot_from_world =
-		//This matrix converts from the spotlight's clip space ([-1,1]^3) into depth map texture coordinates ([0,1]^2) and depth map Z values ([0,1]):
+		//This matrix converts from the spotlight's clip space ([-1,1]^2 x clip depth) into depth map texture coordinates ([0,1]^2) and depth map Z values ([0,1]):
 		glm::mat4(
 			0.5f, 0.0f, 0.0f, 0.0f,
 			0.0f, 0.5f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.5f, 0.0f,
-			0.5f, 0.5f, 0.5f+0.00001f /* <-- bias */, 1.0f
+			0.0f, 0.0f, z_scale, 0.0f,
+			0.5f, 0.5f, z_offset + bias /* <-- bias */, 1.0f
 		)
 		//this is the world-to-clip matrix used when rendering the shadow map:
-		* spot->make_projection() * glm::mat4(spot->transform->make_local_from_world());
+		* frame.spot_clip_from_world;
 
-	glUniformMatrix4fv(shadowed_color_texture_program->SPOT_FROM_LIGHT_mat4, 1, GL_FALSE, glm::value_ptr(spot_from_world));
+	lights.SPOT_FROM_LIGHT = spot_from_world;
 
-	glm::mat4 world_from_spot = spot->transform->make_world_from_local();
-	glUniform3fv(shadowed_color_texture_program->spot_position_vec3, 1, glm::value_ptr(glm::vec3(world_from_spot[3])));
-	glUniform3fv(shadowed_color_texture_program->spot_direction_vec3, 1, glm::value_ptr(-glm::vec3(world_from_spot[2])));
-	glUniform3fv(shadowed_color_texture_program->spot_color_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 1.0f)));
+	lights.spot_position = glm::vec4(frame.spot_position, 1.0f);
+	lights.spot_direction = glm::vec4(frame.spot_direction, 0.0f);
+	lights.spot_color = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
 
-	glm::vec2 spot_outer_inner = glm::vec2(std::cos(0.5f * spot->spot_fov), std::cos(0.85f * 0.5f * spot->spot_fov));
-	glUniform2fv(shadowed_color_texture_program->spot_outer_inner_vec2, 1, glm::value_ptr(spot_outer_inner));
+	lights.spot_outer_inner = glm::vec2(std::cos(0.5f * frame.spot_fov), std::cos(0.85f * 0.5f * frame.spot_fov));
+
+	//...and send them all to the GL at once:
+	GPURingBuffer::Allocation lights_data = frame_ring.allocate(sizeof(lights), GPURingBuffer::Uniform);
+	std::memcpy(lights_data.data, &lights, sizeof(lights));
+	frame_ring.flush();
+	glBindBufferRange(GL_UNIFORM_BUFFER, ShadowedColorTextureProgram::LightsBinding, lights_data.buffer, lights_data.offset, lights_data.size);
+	render_stats.frame.uniform_uploads += 1;
+	render_stats.frame.buffer_bytes += lights_data.size;
 
 	//This code binds texture index 1 to the shadow map:
 	// (note that this is a bit brittle -- it depends on none of the objects in the scene having a texture of index 1 set in their material data; otherwise scene::draw would unbind this texture):
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, fbs.shadow_depth_tex);
+	render_stats.frame.texture_binds += 1;
 	//The shadow_depth_tex must have these parameters set to be used as a sampler2DShadow in the shader:
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LESS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, depth_less);
 	//NOTE: however, these are parameters of the texture object, not the binding point, so there is no need to set them *each frame*. I'm doing it here so that you are likely to see that they are being set.
 	glActiveTexture(GL_TEXTURE0);
 
-	scene->draw(*camera);
+	Scene::submit(frame.shaded);
+
+	if (prepass) {
+		glDepthMask(GL_TRUE);
+		glDepthFunc(depth_less);
+	}
 
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glActiveTexture(GL_TEXTURE0);
 
+	//restore default depth state:
+	glDepthFunc(GL_LESS);
+	glClearDepth(1.0);
+	if (gl_ext.clip_control) {
+		gl_ext.ClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+	}
+
+	profiler.gpu_end();
+	scene_pass_stats = render_stats.frame - pass_begin;
+
+	GL_ERRORS();
+
+	//----- post-process to the window -----
+	//Each enabled effect reads the previous one's output.
+	// Intermediate results ping-pong between two pooled targets at internal resolution,
+	// and the last effect draws to the window (which also upscales, if needed).
+
+	enum Effect { ToneMap, FXAA, Vignette, Copy };
+	std::vector< Effect > effects;
+	if (tone_map) effects.emplace_back(ToneMap);
+	if (fxaa) effects.emplace_back(FXAA);
+	if (vignette) effects.emplace_back(Vignette);
+	if (effects.empty()) effects.emplace_back(Copy); //still need to get the image to the window
+
+	pass_begin = render_stats.frame;
+	profiler.gpu_begin("post-process");
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	RenderTarget *ping_pong[2] = { nullptr, nullptr };
+	GLuint source = fbs.color_tex;
+	for (uint32_t i = 0; i < effects.size(); ++i) {
+		bool last = (i + 1 == effects.size());
+		if (last) {
+			glBindFramebuffer(GL_FRAMEBUFFER, output_fb);
+			glViewport(0,0,drawable_size.x, drawable_size.y);
+		} else {
+			RenderTarget *&target = ping_pong[i % 2];
+			//intermediate results are stored sRGB-encoded (automatically, thanks to GL_FRAMEBUFFER_SRGB) to avoid banding in dark areas:
+			if (!target) target = render_targets.acquire(max_size, GL_SRGB8_ALPHA8);
+			glBindFramebuffer(GL_FRAMEBUFFER, target->fb);
+			glViewport(0,0,internal_size.x, internal_size.y);
+		}
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, source);
+		render_stats.frame.texture_binds += 1;
+		render_stats.frame.program_binds += 1;
+
+		//every pass reads the image from the [0, uv_scale] corner of a max_size texture:
+		auto set_image_uniforms = [&](GLuint uv_scale_vec2, GLuint texel_size_vec2) {
+			glUniform2fv(uv_scale_vec2, 1, glm::value_ptr(uv_scale));
+			glUniform2fv(texel_size_vec2, 1, glm::value_ptr(texel_size));
+			render_stats.frame.uniform_uploads += 2;
+		};
+
+		if (effects[i] == ToneMap) {
+			glUseProgram(tone_map_program->program);
+			set_image_uniforms(tone_map_program->uv_scale_vec2, tone_map_program->texel_size_vec2);
+			glUniform1f(tone_map_program->exposure_float, exposure);
+			render_stats.frame.uniform_uploads += 1;
+		} else if (effects[i] == FXAA) {
+			glUseProgram(fxaa_program->program);
+			set_image_uniforms(fxaa_program->uv_scale_vec2, fxaa_program->texel_size_vec2);
+		} else if (effects[i] == Vignette) {
+			glUseProgram(vignette_program->program);
+			set_image_uniforms(vignette_program->uv_scale_vec2, vignette_program->texel_size_vec2);
+			glUniform1f(vignette_program->strength_float, vignette_strength);
+			glUniform2fv(vignette_program->inner_outer_vec2, 1, glm::value_ptr(glm::vec2(0.5f, 1.0f)));
+			render_stats.frame.uniform_uploads += 2;
+		} else { assert(effects[i] == Copy);
+			glUseProgram(copy_program->program);
+			set_image_uniforms(copy_program->uv_scale_vec2, copy_program->texel_size_vec2);
+		}
+
+		draw_fullscreen_triangle();
+
+		if (!last) source = ping_pong[i % 2]->tex;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+
+	for (RenderTarget *target : ping_pong) {
+		if (target) render_targets.release(target);
+	}
+	render_targets.end_frame();
+	profiler.gpu_end();
+	post_pass_stats = render_stats.frame - pass_begin;
+
+	frame_timer.end();
+
 	GL_ERRORS();
 }
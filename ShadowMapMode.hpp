@@ -1,6 +1,16 @@
 #pragma once
 
 #include "Mode.hpp"
+#include "Scene.hpp"
+#include "DynamicResolution.hpp"
+#include "GPUTimer.hpp"
+#include "RenderStats.hpp"
+
+#include <string>
+
+//base name of the content ShadowMapMode loads (<scene_name>.pnct and <scene_name>.scene, relative to dist/):
+// (set before call_load_functions(); see generate-scene.cpp for making more)
+extern std::string scene_name;
 
 struct ShadowMapMode : public Mode {
 	ShadowMapMode();
@@ -14,9 +24,33 @@ struct ShadowMapMode : public Mode {
 	//update is called at the start of a new frame, after events are handled:
 	virtual void update(float elapsed) override;
 
+	//record is called after update, and captures everything draw needs from the scene into a Frame:
+	virtual void record(glm::uvec2 const &drawable_size) override;
+	//flip makes the most recently recorded Frame the one draw uses:
+	virtual void flip() override;
+	//draw only looks at recorded Frames, so update + record may run on another thread while it does:
+	virtual bool can_pipeline() const override { return true; }
+
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 
+	//Everything draw needs from the scene, as captured by record:
+	struct Frame {
+		Scene::DepthConvention depth_convention = Scene::DepthStandard;
+		Scene::DrawList shadow; //depth-only pipelines, from the spotlight
+		Scene::DrawList prepass; //depth-only pipelines, from the camera (empty if depth_prepass is PrepassOff)
+		Scene::DrawList shaded; //default pipelines, from the camera
+		Scene::Complexity shaded_complexity, prepass_complexity; //(for deciding whether to use the pre-pass)
+		//spotlight info:
+		glm::mat4 spot_clip_from_world = glm::mat4(1.0f);
+		glm::vec3 spot_position = glm::vec3(0.0f);
+		glm::vec3 spot_direction = glm::vec3(0.0f, 0.0f, -1.0f);
+		float spot_fov = 0.0f;
+	};
+	//one frame is drawn while the next is recorded:
+	Frame frames[2];
+	uint32_t draw_frame = 0; //index of the frame draw uses; record fills the other
+
 	//input tracking:
 	struct Button {
 		uint8_t downs = 0;
@@ -25,4 +59,76 @@ struct ShadowMapMode : public Mode {
 
 	float camera_spin = 0.0f;
 	float spot_spin = 0.0f;
+
+	//camera position before the most recent update (draw interpolates from here using draw_alpha):
+	glm::vec3 previous_camera_position = glm::vec3(0.0f);
+
+	//scripted camera path, for repeatable benchmarks (see Headless.hpp):
+	// when enabled, update ignores input and orbits the camera around the scene's z axis
+	// (keeping its starting height and distance, and looking where it started looking) while the spotlight spins
+	bool camera_path = false;
+	float camera_path_duration = 10.0f; //seconds per orbit
+	float camera_path_time = 0.0f;
+	glm::vec3 camera_path_start = glm::vec3(0.0f); //(set in constructor)
+	glm::vec3 camera_path_target = glm::vec3(0.0f);
+	//go back to the start of the path (camera at camera_path_start, spotlight unspun):
+	void restart_camera_path();
+
+	//extra copies of the static scenery, laid out in a grid next to the original, for scaling benchmarks:
+	// (copies are removed again when the mode is destroyed)
+	void set_scene_copies(uint32_t copies); //total copies, including the original
+	uint32_t scene_copies = 1;
+	std::vector< Scene::Transform * > copy_transforms;
+	std::vector< Scene::Drawable * > copy_drawables;
+
+	//render with reversed-Z depth (toggle with 'Z'):
+	bool reversed_z = true;
+	//offset applied to depths looked up in the shadow map (in [0,1] depth map units; pushes surfaces away from the light):
+	float shadow_bias = 0.00001f;
+
+	//level-of-detail bias for the camera's passes (see Scene::record; 'L' toggles levels of detail off and on):
+	float lod_bias = 0.0f;
+	//...plus this for the shadow map, which can get away with coarser casters since it only captures silhouettes:
+	float shadow_lod_bias = 1.0f;
+
+	//depth pre-pass for the camera view (cycle with 'P'):
+	// lays down depth with the cheap depth-only pipelines first, so the shadowed shading pass
+	// (run with GL_EQUAL depth test) shades each pixel only once, no matter the overdraw.
+	enum DepthPrepass : uint8_t {
+		PrepassOff,
+		PrepassOn,
+		PrepassAuto, //decide based on scene complexity (see below)
+	} depth_prepass = PrepassAuto;
+	//PrepassAuto enables the pre-pass when there are enough drawables to make overdraw likely,
+	// and few enough vertices (relative to pixels) that drawing them a second time is cheap:
+	uint32_t prepass_min_drawables = 8;
+	float prepass_max_vertices_per_pixel = 0.5f;
+	bool use_depth_prepass(Frame const &frame, glm::uvec2 const &drawable_size) const;
+
+	//the scene is drawn at (render_scale * drawable size) and post-processed to the window (adjust with '-' and '='):
+	float render_scale = 1.0f;
+	//offscreen targets are always allocated at (max_render_scale * drawable size), so changing render_scale doesn't reallocate:
+	float max_render_scale = 1.0f;
+
+	//dynamic resolution (toggle with 'R') drives render_scale to keep GPU frame time within a budget:
+	bool dynamic_resolution = true;
+	DynamicResolution resolution;
+	GPUTimer frame_timer;
+	//most recent GPU frame time measured by frame_timer (results arrive a few frames late):
+	double gpu_ms = 0.0;
+	uint32_t gpu_ms_count = 0; //measurements so far
+
+	//work done by each pass of the most recent draw (see RenderStats.hpp):
+	RenderStats::Counts shadow_pass_stats, scene_pass_stats, post_pass_stats;
+
+	//framebuffer the final (post-processed) image is drawn to:
+	// (0 is the window; headless rendering supplies its own)
+	GLuint output_fb = 0;
+
+	//post-processing effects (toggle with 'T', 'F', 'V'):
+	bool tone_map = true;
+	float exposure = 1.0f;
+	bool fxaa = true;
+	bool vignette = true;
+	float vignette_strength = 0.3f;
 };
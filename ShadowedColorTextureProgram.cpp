@@ -3,14 +3,30 @@
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
 
+#include <string>
+
+//GLSL declaration of ShadowedColorTextureProgram::Lights (used by both shader stages):
+static const char *lights_block =
+	"layout(std140) uniform Lights {\n"
+	"	vec3 sun_direction;\n"
+	"	vec3 sun_color;\n"
+	"	vec3 sky_direction;\n"
+	"	vec3 sky_color;\n"
+	"	vec3 spot_position;\n"
+	"	vec3 spot_direction;\n"
+	"	vec3 spot_color;\n"
+	"	vec2 spot_outer_inner;\n"
+	"	mat4 SPOT_FROM_LIGHT;\n"
+	"};\n"
+;
+
 ShadowedColorTextureProgram::ShadowedColorTextureProgram() {
 	program = gl_compile_program(
 		"#version 330\n"
-		"uniform mat4 CLIP_FROM_OBJECT;\n"
-		"uniform mat4x3 LIGHT_FROM_OBJECT;\n"
-		"uniform mat3 LIGHT_FROM_NORMAL;\n"
-		"uniform mat4 SPOT_FROM_LIGHT;\n"
+		+ std::string(Scene::ObjectBlockGLSL)
+		+ lights_block +
 		"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
+		"invariant gl_Position;\n" //note: must match exactly between depth pre-pass and shading pass for GL_EQUAL depth testing
 		"in vec3 Normal;\n"
 		"in vec4 Color;\n"
 		"in vec2 TexCoord;\n"
@@ -29,14 +45,7 @@ ShadowedColorTextureProgram::ShadowedColorTextureProgram() {
 		"}\n"
 		,
 		"#version 330\n"
-		"uniform vec3 sun_direction;\n"
-		"uniform vec3 sun_color;\n"
-		"uniform vec3 sky_direction;\n"
-		"uniform vec3 sky_color;\n"
-		"uniform vec3 spot_position;\n"
-		"uniform vec3 spot_direction;\n"
-		"uniform vec3 spot_color;\n"
-		"uniform vec2 spot_outer_inner;\n"
+		+ std::string(lights_block) +
 		"uniform sampler2D tex;\n"
 		"uniform sampler2DShadow spot_depth_tex;\n"
 		"in vec3 position;\n"
@@ -73,21 +82,8 @@ ShadowedColorTextureProgram::ShadowedColorTextureProgram() {
 		"}\n"
 	);
 
-	CLIP_FROM_OBJECT_mat4 = glGetUniformLocation(program, "CLIP_FROM_OBJECT");
-	LIGHT_FROM_OBJECT_mat4x3 = glGetUniformLocation(program, "LIGHT_FROM_OBJECT");
-	LIGHT_FROM_NORMAL_mat3 = glGetUniformLocation(program, "LIGHT_FROM_NORMAL");
-
-	sun_direction_vec3 = glGetUniformLocation(program, "sun_direction");
-	sun_color_vec3 = glGetUniformLocation(program, "sun_color");
-	sky_direction_vec3 = glGetUniformLocation(program, "sky_direction");
-	sky_color_vec3 = glGetUniformLocation(program, "sky_color");
-
-	spot_position_vec3 = glGetUniformLocation(program, "spot_position");
-	spot_direction_vec3 = glGetUniformLocation(program, "spot_direction");
-	spot_color_vec3 = glGetUniformLocation(program, "spot_color");
-	spot_outer_inner_vec2 = glGetUniformLocation(program, "spot_outer_inner");
-
-	SPOT_FROM_LIGHT_mat4 = glGetUniformLocation(program, "SPOT_FROM_LIGHT");
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Object"), Scene::ObjectBlockBinding);
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Lights"), LightsBinding);
 
 	glUseProgram(program);
 
@@ -105,18 +101,16 @@ ShadowedColorTextureProgram::ShadowedColorTextureProgram() {
 Load< ShadowedColorTextureProgram > shadowed_color_texture_program(LoadTagEarly, []() -> ShadowedColorTextureProgram const * {
 	ShadowedColorTextureProgram *ret = new ShadowedColorTextureProgram();
 
-	shadowed_color_texture_program_pipeline.program = ret->program;
+	shadowed_color_texture_program_material.program = ret->program;
 
-	shadowed_color_texture_program_pipeline.CLIP_FROM_OBJECT_mat4 = ret->CLIP_FROM_OBJECT_mat4;
-	shadowed_color_texture_program_pipeline.LIGHT_FROM_OBJECT_mat4x3 = ret->LIGHT_FROM_OBJECT_mat4x3;
-	shadowed_color_texture_program_pipeline.LIGHT_FROM_NORMAL_mat3 = ret->LIGHT_FROM_NORMAL_mat3;
+	shadowed_color_texture_program_material.object_block = true;
 
 	/* This will be used later if/when we build a light loop into the Scene:
-	shadowed_color_texture_program_pipeline.LIGHT_TYPE_int = ret->LIGHT_TYPE_int;
-	shadowed_color_texture_program_pipeline.LIGHT_LOCATION_vec3 = ret->LIGHT_LOCATION_vec3;
-	shadowed_color_texture_program_pipeline.LIGHT_DIRECTION_vec3 = ret->LIGHT_DIRECTION_vec3;
-	shadowed_color_texture_program_pipeline.LIGHT_ENERGY_vec3 = ret->LIGHT_ENERGY_vec3;
-	shadowed_color_texture_program_pipeline.LIGHT_CUTOFF_float = ret->LIGHT_CUTOFF_float;
+	shadowed_color_texture_program_material.LIGHT_TYPE_int = ret->LIGHT_TYPE_int;
+	shadowed_color_texture_program_material.LIGHT_LOCATION_vec3 = ret->LIGHT_LOCATION_vec3;
+	shadowed_color_texture_program_material.LIGHT_DIRECTION_vec3 = ret->LIGHT_DIRECTION_vec3;
+	shadowed_color_texture_program_material.LIGHT_ENERGY_vec3 = ret->LIGHT_ENERGY_vec3;
+	shadowed_color_texture_program_material.LIGHT_CUTOFF_float = ret->LIGHT_CUTOFF_float;
 	*/
 
 	//make a 1-pixel white texture to bind by default:
@@ -133,10 +127,10 @@ Load< ShadowedColorTextureProgram > shadowed_color_texture_program(LoadTagEarly,
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 
-	shadowed_color_texture_program_pipeline.textures[0].texture = tex;
-	shadowed_color_texture_program_pipeline.textures[0].target = GL_TEXTURE_2D;
+	shadowed_color_texture_program_material.textures[0].texture = tex;
+	shadowed_color_texture_program_material.textures[0].target = GL_TEXTURE_2D;
 
 	return ret;
 });
 
-Scene::Drawable::Pipeline shadowed_color_texture_program_pipeline;
+Scene::Material shadowed_color_texture_program_material;
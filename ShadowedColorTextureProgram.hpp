@@ -9,21 +9,25 @@ struct ShadowedColorTextureProgram {
 	//opengl program object:
 	GLuint program = 0;
 
-	//uniform locations:
-	GLuint CLIP_FROM_OBJECT_mat4 = -1U;
-	GLuint LIGHT_FROM_OBJECT_mat4x3 = -1U;
-	GLuint LIGHT_FROM_NORMAL_mat3 = -1U;
-
-	GLuint sun_direction_vec3 = -1U; //direction *to* sun
-	GLuint sun_color_vec3 = -1U;
-	GLuint sky_direction_vec3 = -1U; //direction *to* sky
-	GLuint sky_color_vec3 = -1U;
-
-	GLuint spot_position_vec3 = -1U;
-	GLuint spot_direction_vec3 = -1U; //direction *from* spotlight
-	GLuint spot_color_vec3 = -1U;
-	GLuint spot_outer_inner_vec2 = -1U; //color fades from zero to one as dot(spot_direction, spot_to_position) varies from outer_inner.x to outer_inner.y
-	GLuint SPOT_FROM_LIGHT_mat4 = -1U; //projects from lighting space (/world space) to spot light depth map space
+	//uniform blocks:
+	//per-object matrices come from Scene's 'Object' block (see Scene::ObjectBlock)
+
+	//per-frame lighting comes from a 'Lights' block, bound to LightsBinding, with this (std140) layout:
+	enum : GLuint { LightsBinding = 1 };
+	struct Lights {
+		glm::vec4 sun_direction = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f); //direction *to* sun
+		glm::vec4 sun_color = glm::vec4(0.0f);
+		glm::vec4 sky_direction = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f); //direction *to* sky
+		glm::vec4 sky_color = glm::vec4(0.0f);
+
+		glm::vec4 spot_position = glm::vec4(0.0f);
+		glm::vec4 spot_direction = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f); //direction *from* spotlight
+		glm::vec4 spot_color = glm::vec4(0.0f);
+		glm::vec2 spot_outer_inner = glm::vec2(0.0f); //color fades from zero to one as dot(spot_direction, spot_to_position) varies from outer_inner.x to outer_inner.y
+		glm::vec2 padding_ = glm::vec2(0.0f); //(std140 aligns the next member to 16 bytes)
+		glm::mat4 SPOT_FROM_LIGHT = glm::mat4(1.0f); //projects from lighting space (/world space) to spot light depth map space
+	};
+	static_assert(sizeof(Lights) == 7*16 + 16 + 64, "Lights matches std140 layout.");
 
 	//textures:
 	//texture0 - texture for the surface
@@ -34,4 +38,4 @@ struct ShadowedColorTextureProgram {
 
 extern Load< ShadowedColorTextureProgram > shadowed_color_texture_program;
 
-extern Scene::Drawable::Pipeline shadowed_color_texture_program_pipeline;
+extern Scene::Material shadowed_color_texture_program_material;
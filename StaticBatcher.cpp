@@ -0,0 +1,148 @@
+#include "StaticBatcher.hpp"
+
+#include "gl_errors.hpp"
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Drawables can be merged if they would draw the same way, apart from which vertices they draw:
+// (i.e., they use the same materials and primitive types)
+static auto merge_key(Scene::Drawable const &drawable) {
+	std::vector< uint32_t > key;
+	for (auto const &pipeline : drawable.pipelines) {
+		key.insert(key.end(), { pipeline.material, uint32_t(pipeline.type) });
+	}
+	return key;
+}
+
+//n.b. merged drawables share one vertex range, so all pipeline types must draw the same vertices:
+static bool can_merge(Scene const &scene, Scene::Drawable const &drawable) {
+	if (!drawable.is_static) return false;
+	if (drawable.lod.count != 0) return false; //(batches can't switch levels of detail, so drawables with them are left alone)
+	Scene::Drawable::Pipeline const &first = drawable.pipelines[0];
+	if (first.type != GL_TRIANGLES) return false; //(other primitive types can't be concatenated in general)
+	for (uint32_t p = 0; p < Scene::Drawable::PipelineTypes; ++p) {
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipelines[p];
+		if (pipeline.material != Scene::NoMaterial && scene.materials[pipeline.material]->set_uniforms) return false;
+		if (!scene.get_material(drawable, Scene::Drawable::PipelineType(p))) continue;
+		if (pipeline.start != first.start || pipeline.count != first.count || pipeline.type != first.type) return false;
+	}
+	return first.count != 0;
+}
+
+StaticBatcher::Result StaticBatcher::batch(Scene &scene, MeshBuffer const &source) {
+	Result result;
+	result.draws_before = uint32_t(scene.drawables.size());
+
+	//group mergeable drawables:
+	std::map< std::vector< uint32_t >, std::vector< Scene::Drawable * > > groups;
+	for (Scene::Drawable &drawable : scene.drawables) {
+		Scene::Drawable *d = &drawable;
+		if (!can_merge(scene, *d)) continue;
+		Scene::Drawable::Pipeline const &pipeline = d->pipelines[0];
+		if (!(pipeline.start + pipeline.count <= source.vertices.size())) {
+			throw std::runtime_error("StaticBatcher: static drawable '" + d->transform->name.str() + "' has vertices outside the source buffer (was it loaded with keep_vertices?).");
+		}
+		groups[merge_key(*d)].emplace_back(d);
+	}
+
+	//pre-transform each group of two or more drawables into one range of vertices:
+	std::vector< MeshBuffer::Vertex > merged;
+	struct Range {
+		GLuint start, count;
+		std::vector< Scene::Drawable * > const *members;
+	};
+	std::vector< Range > ranges;
+	for (auto const &[key, members] : groups) {
+		if (members.size() < 2) continue; //nothing to gain
+		Range range;
+		range.start = GLuint(merged.size());
+		range.members = &members;
+		for (auto const &d : members) {
+			glm::mat4x3 world_from_object = d->transform->make_world_from_local();
+			glm::mat3 world_from_normal = glm::inverse(glm::transpose(glm::mat3(world_from_object)));
+			Scene::Drawable::Pipeline const &pipeline = d->pipelines[0];
+			GLuint begin = GLuint(merged.size());
+			for (GLuint v = pipeline.start; v < pipeline.start + pipeline.count; ++v) {
+				MeshBuffer::Vertex vertex = source.vertices[v];
+				vertex.Position = world_from_object * glm::vec4(vertex.Position, 1.0f);
+				vertex.Normal = glm::normalize(world_from_normal * vertex.Normal);
+				merged.emplace_back(vertex);
+				result.min = glm::min(result.min, vertex.Position);
+				result.max = glm::max(result.max, vertex.Position);
+			}
+			//mirroring transforms flip triangle winding, so flip it back (keeps face culling working):
+			if (glm::determinant(glm::mat3(world_from_object)) < 0.0f) {
+				for (GLuint t = begin; t + 2 < GLuint(merged.size()); t += 3) {
+					std::swap(merged[t+1], merged[t+2]);
+				}
+			}
+		}
+		range.count = GLuint(merged.size()) - range.start;
+		ranges.emplace_back(range);
+	}
+
+	if (ranges.empty()) {
+		result.draws_after = result.draws_before;
+		return result;
+	}
+
+	result.buffer = new MeshBuffer(merged);
+
+	//merged vertices need their own vertex arrays (one per program):
+	std::map< GLuint, GLuint > vao_for_program;
+	auto get_vao = [&](GLuint program) {
+		auto f = vao_for_program.find(program);
+		if (f == vao_for_program.end()) {
+			f = vao_for_program.emplace(program, result.buffer->make_vao_for_program(program)).first;
+		}
+		return f->second;
+	};
+
+	//...so batches use copies of their members' materials that read from those vertex arrays:
+	std::map< uint32_t, uint32_t > batch_material_for;
+	auto get_batch_material = [&](uint32_t material) {
+		auto f = batch_material_for.find(material);
+		if (f == batch_material_for.end()) {
+			Scene::Material copy = *scene.materials[material];
+			copy.vao = get_vao(copy.program);
+			f = batch_material_for.emplace(material, scene.add_material(copy)).first;
+		}
+		return f->second;
+	};
+
+	//replace each group with one drawable:
+	for (Range const &range : ranges) {
+		Scene::Transform &transform = scene.transforms.emplace_back();
+		transform.name = InternedString("StaticBatch." + std::to_string(result.batches));
+
+		Scene::Drawable &batch = scene.drawables.emplace_back(&transform);
+		batch.is_static = true;
+		//all members have the same pipelines (apart from vertex ranges), so start from the first:
+		Scene::Drawable const &first = *range.members->front();
+		for (uint32_t p = 0; p < Scene::Drawable::PipelineTypes; ++p) {
+			batch.pipelines[p] = first.pipelines[p];
+			if (!scene.get_material(first, Scene::Drawable::PipelineType(p))) continue;
+			batch.pipelines[p].material = get_batch_material(first.pipelines[p].material);
+			batch.pipelines[p].start = range.start;
+			batch.pipelines[p].count = range.count;
+		}
+
+		for (auto const &d : *range.members) {
+			scene.drawables.erase(d);
+		}
+
+		result.batches += 1;
+	}
+
+	GL_ERRORS();
+
+	//(batches were given new transforms)
+	scene.index_names();
+
+	result.draws_after = uint32_t(scene.drawables.size());
+	return result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * StaticBatcher merges static drawables (Drawable::is_static) that would be
+ *  drawn the same way -- same materials and primitive types -- into one
+ *  drawable per group, at load time.
+ *
+ * Each group's vertices are pre-transformed into world space and stored as
+ *  one range in a new MeshBuffer, and the group's drawables are replaced by
+ *  a single drawable (attached to a new identity transform) that draws it.
+ *
+ * Batches draw with copies of their members' materials (added to
+ *  Scene::materials) that read vertices from the new MeshBuffer.
+ *
+ * Drawables whose materials have a 'set_uniforms' function are never merged,
+ *  since it may set uniforms that differ per object.
+ * Nor are drawables with levels of detail (Drawable::lod), since a batch
+ *  draws all of its members' vertices at one level.
+ *
+ */
+
+#include "Scene.hpp"
+#include "Mesh.hpp"
+
+struct StaticBatcher {
+	struct Result {
+		MeshBuffer *buffer = nullptr; //holds merged vertices (caller owns; must outlive the scene's use of it); null if nothing was merged
+		uint32_t draws_before = 0; //drawables in scene before merging
+		uint32_t draws_after = 0; //drawables in scene after merging
+		uint32_t batches = 0; //merged drawables created
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity()); //bounding box of merged vertices (world space)
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	};
+
+	//merge static drawables in 'scene' whose vertices come from 'source':
+	// 'source' must have been loaded with 'keep_vertices' set.
+	// note: will throw if a static drawable's vertex range isn't inside 'source'.
+	static Result batch(Scene &scene, MeshBuffer const &source);
+};
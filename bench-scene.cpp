@@ -0,0 +1,228 @@
+//Benchmark for Scene storage: building, copying (Scene::set), looking up names in, and tearing down a big scene.
+//
+// Builds a synthetic scene with a large transform hierarchy (a drawable per
+//  transform, plus a few cameras and lights) and times each operation, along
+//  with the same work done on std::lists (the way Scene used to store things),
+//  counting heap allocations for each.
+//
+// Usage: bench-scene [--transforms N] [--reps R]
+
+#include "Scene.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//count heap allocations made by the whole program:
+static std::atomic< uint64_t > allocations(0);
+void *operator new(std::size_t size) {
+	allocations += 1;
+	if (void *ret = std::malloc(size ? size : 1)) return ret;
+	throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+//the way Scene used to store things, for comparison:
+struct ListTransform {
+	std::string name;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+	ListTransform *parent = nullptr;
+};
+struct ListScene {
+	std::list< ListTransform > transforms;
+	std::list< Scene::Drawable > drawables; //(transform pointers actually point to ListTransforms)
+	std::list< Scene::Camera > cameras;
+	std::list< Scene::Light > lights;
+
+	void set(ListScene const &other) {
+		std::unordered_map< ListTransform const *, ListTransform * > transform_to_transform;
+		transform_to_transform.insert(std::make_pair(nullptr, nullptr));
+		transforms.clear();
+		for (auto const &t : other.transforms) {
+			transforms.emplace_back(t);
+			transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
+		}
+		for (auto &t : transforms) {
+			t.parent = transform_to_transform.at(t.parent);
+		}
+		auto fixup = [&](Scene::Transform *t) {
+			return reinterpret_cast< Scene::Transform * >(transform_to_transform.at(reinterpret_cast< ListTransform const * >(t)));
+		};
+		drawables = other.drawables;
+		for (auto &d : drawables) d.transform = fixup(d.transform);
+		cameras = other.cameras;
+		for (auto &c : cameras) c.transform = fixup(c.transform);
+		lights = other.lights;
+		for (auto &l : lights) l.transform = fixup(l.transform);
+	}
+};
+
+static void set_name(Scene::Transform *t, std::string const &name) { t->name = InternedString(name); }
+static void set_name(ListTransform *t, std::string const &name) { t->name = name; }
+
+//build a random forest, parents always before children (as when loaded), with a drawable per transform:
+template< typename S, typename T >
+static void build(S *scene, uint32_t transform_count) {
+	std::mt19937 mt(0x15466);
+	std::vector< T * > made;
+	made.reserve(transform_count);
+	for (uint32_t i = 0; i < transform_count; ++i) {
+		T &t = scene->transforms.emplace_back();
+		set_name(&t, "Transform." + std::to_string(i));
+		t.position = glm::vec3(float(mt() % 100), float(mt() % 100), float(mt() % 100));
+		if (i > 0 && mt() % 8 != 0) t.parent = made[mt() % i];
+		made.emplace_back(&t);
+		scene->drawables.emplace_back(reinterpret_cast< Scene::Transform * >(&t));
+	}
+	for (uint32_t i = 0; i < 4; ++i) {
+		scene->cameras.emplace_back(reinterpret_cast< Scene::Transform * >(made[mt() % transform_count]));
+		scene->lights.emplace_back(reinterpret_cast< Scene::Transform * >(made[mt() % transform_count]));
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t transform_count = 100000;
+	uint32_t reps = 20;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--transforms" && argi + 1 < argc) {
+			transform_count = uint32_t(std::max(1, std::atoi(argv[argi+1])));
+			argi += 1;
+		} else if (arg == "--reps" && argi + 1 < argc) {
+			reps = uint32_t(std::max(1, std::atoi(argv[argi+1])));
+			argi += 1;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--transforms N] [--reps R]" << std::endl;
+			return 1;
+		}
+	}
+
+	//time a function (run 'reps' times, with 'setup' -- untimed -- before each run):
+	auto time = [&](std::string const &label, auto const &setup, auto const &fn) {
+		std::vector< double > ms;
+		uint64_t allocs = 0;
+		for (uint32_t r = 0; r < reps; ++r) {
+			setup();
+			uint64_t allocs_before = allocations;
+			auto before = std::chrono::high_resolution_clock::now();
+			fn();
+			auto after = std::chrono::high_resolution_clock::now();
+			allocs = allocations - allocs_before;
+			ms.emplace_back(std::chrono::duration< double >(after - before).count() * 1000.0);
+		}
+		std::sort(ms.begin(), ms.end());
+		double total = 0.0;
+		for (double m : ms) total += m;
+		std::cout << "  " << label << ": min " << ms.front() << "ms, median " << ms[ms.size()/2] << "ms, avg " << total / ms.size() << "ms; " << allocs << " allocations." << std::endl;
+	};
+	auto nothing = [](){ };
+
+	std::cout << "Scene of " << transform_count << " transforms (and as many drawables), over " << reps << " runs:" << std::endl;
+
+	std::unique_ptr< Scene > built;
+	std::unique_ptr< ListScene > list_built;
+
+	std::cout << "Build:" << std::endl;
+	time("Scene (including name index)", [&](){ built.reset(new Scene()); }, [&](){
+		build< Scene, Scene::Transform >(built.get(), transform_count);
+		built->index_names();
+	});
+	time("std::list", [&](){ list_built.reset(new ListScene()); }, [&](){
+		build< ListScene, ListTransform >(list_built.get(), transform_count);
+	});
+	Scene const &scene = *built;
+	ListScene const &list_scene = *list_built;
+
+	std::cout << "Copy:" << std::endl;
+	Scene copy;
+	time("Scene::set", nothing, [&](){
+		copy.set(scene);
+	});
+	ListScene list_copy;
+	time("std::list + unordered_map (previous Scene::set)", nothing, [&](){
+		list_copy.set(list_scene);
+	});
+
+	std::cout << "Find by name (per 1000 lookups):" << std::endl;
+	{
+		std::mt19937 mt(0x466);
+		std::vector< std::string > names;
+		std::vector< InternedString > interned;
+		for (uint32_t i = 0; i < 1000; ++i) {
+			names.emplace_back("Transform." + std::to_string(mt() % transform_count));
+			interned.emplace_back(names.back());
+		}
+		Scene::Transform *found = nullptr;
+		time("Scene::find_transform (interned name)", nothing, [&](){
+			for (auto const &name : interned) {
+				found = built->find_transform(name);
+				if (!found || found->name != name) throw std::runtime_error("Failed to find '" + name.str() + "'.");
+			}
+		});
+		time("Scene::find_transform (text)", nothing, [&](){
+			for (auto const &name : names) {
+				found = built->find_transform(name);
+				if (!found) throw std::runtime_error("Failed to find '" + name + "'.");
+			}
+		});
+		time("linear search over std::string names (previous ShadowMapMode lookup)", nothing, [&](){
+			for (auto const &name : names) {
+				ListTransform const *list_found = nullptr;
+				for (auto const &t : list_built->transforms) {
+					if (t.name == name) { list_found = &t; break; }
+				}
+				if (!list_found) throw std::runtime_error("Failed to find '" + name + "'.");
+			}
+		});
+	}
+
+	std::cout << "Teardown:" << std::endl;
+	{
+		std::unique_ptr< Scene > doomed;
+		time("Scene", [&](){ doomed.reset(new Scene(scene)); }, [&](){
+			doomed.reset();
+		});
+		std::unique_ptr< ListScene > list_doomed;
+		time("std::list", [&](){ list_doomed.reset(new ListScene()); list_doomed->set(list_scene); }, [&](){
+			list_doomed.reset();
+		});
+	}
+
+	std::cout << "Scene chunk allocations: "
+		<< scene.transforms.chunk_allocations << " (transforms) + "
+		<< scene.drawables.chunk_allocations << " (drawables) + "
+		<< scene.cameras.chunk_allocations << " (cameras) + "
+		<< scene.lights.chunk_allocations << " (lights); std::list allocates once per element." << std::endl;
+
+	//make sure the copy is right:
+	for (uint32_t i = 0; i < transform_count; i += std::max(1U, transform_count / 1000)) {
+		Scene::Transform const &a = scene.transforms[i];
+		Scene::Transform const &b = copy.transforms[i];
+		if (a.name != b.name || a.make_world_from_local() != b.make_world_from_local() || copy.find_transform(a.name) != &b) {
+			throw std::runtime_error("Copy of transform " + std::to_string(i) + " doesn't match.");
+		}
+		if (a.parent && copy.transforms.index_of(b.parent) != scene.transforms.index_of(a.parent)) {
+			throw std::runtime_error("Copy of transform " + std::to_string(i) + " has the wrong parent.");
+		}
+	}
+	for (uint32_t i = 0; i < scene.drawables.size(); ++i) {
+		if (copy.transforms.index_of(copy.drawables[i].transform) != scene.transforms.index_of(scene.drawables[i].transform)) {
+			throw std::runtime_error("Copy of drawable " + std::to_string(i) + " has the wrong transform.");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,471 @@
+//Benchmark suite: microbenchmarks of loading and scene code, plus end-to-end (headless) rendering.
+//
+// Content is the vignette scene (dist/vignette.scene + vignette.pnct; or, with
+//  --content <name>, dist/<name>.scene + <name>.pnct, e.g. from generate-scene) scaled
+//  up procedurally: at scale N, the scene's transform hierarchy is loaded N
+//  times (each copy offset on a grid) and mesh data is repeated N times.
+//
+// Each benchmark is run 'warmup' times untimed, then 'reps' times timed;
+//  results (with min / median / mean / standard deviation / max) are printed
+//  and, with --json, written as machine-readable JSON.
+//
+// Benchmarks that need OpenGL (MeshBuffer loading and rendering) use a
+//  hidden window's context, as in headless mode (see Headless.hpp); they are
+//  skipped if no context can be made, or with --no-gl.
+//
+// Usage: bench [--warmup W] [--reps R] [--scales 1,10,100,1000] [--filter <text>] [--json <file>] [--content <name>] [--no-gl]
+//
+// (bench-scene compares Scene storage against the std::lists it replaced)
+
+#include "Scene.hpp"
+#include "Mesh.hpp"
+#include "Load.hpp"
+#include "ShadowMapMode.hpp"
+#include "Headless.hpp"
+#include "GL.hpp"
+#include "gl_extensions.hpp"
+#include "GPURingBuffer.hpp"
+#include "Profiler.hpp"
+#include "data_path.hpp"
+#include "load_save_png.hpp"
+#include "read_write_chunk.hpp"
+#include "file_entries.hpp"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------ harness ------------
+
+struct Bench {
+	uint32_t warmup = 3;
+	uint32_t reps = 10;
+	std::string filter; //only run benchmarks whose names contain this
+
+	struct Result {
+		std::string name;
+		uint32_t scale = 1;
+		double items = 0.0; //work done per rep (e.g., bytes or transforms), for throughput
+		std::string unit; //what 'items' counts
+		uint32_t warmup = 0;
+		std::vector< double > ms; //timed reps
+		double min = 0.0, median = 0.0, mean = 0.0, stddev = 0.0, max = 0.0;
+	};
+	std::vector< Result > results;
+
+	bool wanted(std::string const &name) const {
+		return filter.empty() || name.find(filter) != std::string::npos;
+	}
+
+	//run 'fn' (with untimed 'setup' before each run) warmup + reps times:
+	template< typename Setup, typename Fn >
+	void run(std::string const &name, uint32_t scale, double items, std::string const &unit, Setup const &setup, Fn const &fn) {
+		if (!wanted(name)) return;
+		std::vector< double > ms;
+		for (uint32_t r = 0; r < warmup + reps; ++r) {
+			setup();
+			auto before = std::chrono::high_resolution_clock::now();
+			fn();
+			auto after = std::chrono::high_resolution_clock::now();
+			if (r >= warmup) ms.emplace_back(std::chrono::duration< double >(after - before).count() * 1000.0);
+		}
+		add(name, scale, items, unit, warmup, ms);
+	}
+	template< typename Fn >
+	void run(std::string const &name, uint32_t scale, double items, std::string const &unit, Fn const &fn) {
+		run(name, scale, items, unit, [](){ }, fn);
+	}
+
+	//record (already measured) times:
+	void add(std::string const &name, uint32_t scale, double items, std::string const &unit, uint32_t warmup_, std::vector< double > const &ms) {
+		if (!wanted(name)) return;
+		Result result;
+		result.name = name;
+		result.scale = scale;
+		result.items = items;
+		result.unit = unit;
+		result.warmup = warmup_;
+		result.ms = ms;
+		if (!ms.empty()) {
+			std::vector< double > sorted = ms;
+			std::sort(sorted.begin(), sorted.end());
+			result.min = sorted.front();
+			result.max = sorted.back();
+			result.median = sorted[sorted.size() / 2];
+			for (double m : sorted) result.mean += m;
+			result.mean /= double(sorted.size());
+			for (double m : sorted) result.stddev += (m - result.mean) * (m - result.mean);
+			result.stddev = std::sqrt(result.stddev / double(sorted.size()));
+		}
+
+		std::cout << "  " << name << " x" << scale << ": median " << result.median << "ms, mean " << result.mean << "ms +/- " << result.stddev << "ms (min " << result.min << "ms, max " << result.max << "ms)";
+		if (items > 0.0 && result.mean > 0.0) std::cout << "; " << items / (result.mean / 1000.0) << " " << unit << "/s";
+		std::cout << std::endl;
+
+		results.emplace_back(result);
+	}
+
+	void write_json(std::string const &filename) const {
+		std::ofstream out(filename, std::ios::binary);
+		if (!out) throw std::runtime_error("Failed to open '" + filename + "' to write results.");
+		//(names include the --content name, so may contain anything)
+		auto quoted = [](std::string const &name) {
+			std::string ret = "\"";
+			for (char c : name) {
+				if (c == '"' || c == '\\') ret += '\\';
+				if (uint8_t(c) < 0x20) {
+					char escape[8];
+					std::snprintf(escape, sizeof(escape), "\\u%04x", uint32_t(uint8_t(c)));
+					ret += escape;
+				} else {
+					ret += c;
+				}
+			}
+			return ret + "\"";
+		};
+
+		out << "{\n\t\"warmup\": " << warmup << ",\n\t\"reps\": " << reps << ",\n\t\"benchmarks\": [";
+		for (uint32_t i = 0; i < results.size(); ++i) {
+			Result const &r = results[i];
+			out << (i ? "," : "") << "\n\t\t{ \"name\": " << quoted(r.name) << ", \"scale\": " << r.scale
+				<< ", \"items\": " << r.items << ", \"unit\": " << quoted(r.unit)
+				<< ", \"warmup\": " << r.warmup << ", \"reps\": " << r.ms.size()
+				<< ", \"min_ms\": " << r.min << ", \"median_ms\": " << r.median << ", \"mean_ms\": " << r.mean
+				<< ", \"stddev_ms\": " << r.stddev << ", \"max_ms\": " << r.max
+				<< ", \"samples_ms\": [";
+			for (uint32_t s = 0; s < r.ms.size(); ++s) out << (s ? ", " : "") << r.ms[s];
+			out << "] }";
+		}
+		out << "\n\t]\n}\n";
+		std::cout << "Wrote " << results.size() << " results to '" << filename << "'." << std::endl;
+	}
+};
+
+//------------ content ------------
+
+//<scene_name>.pnct's contents, read without OpenGL:
+struct MeshData {
+	std::vector< MeshBuffer::Vertex > vertices;
+	std::unordered_map< InternedString, Mesh > meshes;
+	std::string bytes; //the whole file
+};
+
+static MeshData load_mesh_data(std::string const &filename) {
+	MeshData ret;
+	{
+		std::ifstream file(filename, std::ios::binary);
+		std::ostringstream str;
+		str << file.rdbuf();
+		ret.bytes = str.str();
+	}
+	std::istringstream file(ret.bytes);
+
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	read_chunk(file, "pnct", &ret.vertices);
+	read_chunk(file, "str0", &strings);
+	read_chunk(file, "idx0", &index);
+	for (auto const &entry : index) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size()
+		   && entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= ret.vertices.size())) {
+			throw std::runtime_error("Bad index entry in '" + filename + "'.");
+		}
+		Mesh mesh;
+		mesh.start = entry.vertex_begin;
+		mesh.count = entry.vertex_end - entry.vertex_begin;
+		ret.meshes.emplace(InternedString(std::string_view(strings.data() + entry.name_begin, entry.name_end - entry.name_begin)), mesh);
+	}
+	return ret;
+}
+
+//the content's scene, 'scale' times over, with copies offset on a grid:
+// drawables use a stand-in material (never drawn -- no OpenGL needed) so Scene::record does its full work
+static void build_scaled_scene(Scene *scene_, MeshData const &mesh_data, uint32_t scale) {
+	Scene &scene = *scene_;
+	uint32_t material = scene.add_material(Scene::Material{ .program = 1, .vao = 1, .object_block = true });
+
+	uint32_t side = uint32_t(std::ceil(std::sqrt(float(scale))));
+	for (uint32_t c = 0; c < scale; ++c) {
+		uint32_t first = scene.transforms.size();
+		scene.load(data_path(scene_name + ".scene"), [&](Scene &s, Scene::Transform *t, InternedString m){
+			Scene::Drawable &drawable = s.drawables.emplace_back(t);
+			auto f = mesh_data.meshes.find(m);
+			if (f == mesh_data.meshes.end()) return;
+			for (uint32_t p = 0; p < Scene::Drawable::PipelineTypes; ++p) {
+				drawable.pipelines[p].material = material;
+				drawable.pipelines[p].start = f->second.start;
+				drawable.pipelines[p].count = f->second.count;
+			}
+		});
+		glm::vec3 offset = 20.0f * glm::vec3(float(c % side), float(c / side), 0.0f);
+		for (uint32_t i = first; i < scene.transforms.size(); ++i) {
+			if (scene.transforms[i].parent == nullptr) scene.transforms[i].position += offset;
+		}
+	}
+}
+
+//------------ OpenGL context (for the benchmarks that need it) ------------
+
+static SDL_GLContext create_context() {
+	if (!SDL_Init(SDL_INIT_VIDEO)) {
+		//no display? SDL's offscreen driver can still make a context (via EGL):
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+		if (!SDL_Init(SDL_INIT_VIDEO)) {
+			std::cerr << "NOTE: couldn't initialize video (" << SDL_GetError() << "); skipping OpenGL benchmarks." << std::endl;
+			return nullptr;
+		}
+	}
+
+	SDL_GL_ResetAttributes();
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+	Mode::window = SDL_CreateWindow("bench", 1280, 720, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (!Mode::window) {
+		std::cerr << "NOTE: couldn't create window (" << SDL_GetError() << "); skipping OpenGL benchmarks." << std::endl;
+		return nullptr;
+	}
+	SDL_GLContext context = SDL_GL_CreateContext(Mode::window);
+	if (!context) {
+		std::cerr << "NOTE: couldn't create OpenGL context (" << SDL_GetError() << "); skipping OpenGL benchmarks." << std::endl;
+		SDL_DestroyWindow(Mode::window);
+		Mode::window = NULL;
+		return nullptr;
+	}
+	init_GL();
+	init_GL_extensions();
+	SDL_GL_SetSwapInterval(0);
+	glEnable(GL_FRAMEBUFFER_SRGB);
+	return context;
+}
+
+//------------ benchmarks ------------
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	Bench bench;
+	std::vector< uint32_t > scales = { 1, 10, 100, 1000 };
+	std::string json_filename;
+	bool use_gl = true;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--warmup" && argi + 1 < argc) {
+			argi += 1;
+			bench.warmup = uint32_t(std::stoul(argv[argi]));
+		} else if (arg == "--reps" && argi + 1 < argc) {
+			argi += 1;
+			bench.reps = std::max(1U, uint32_t(std::stoul(argv[argi])));
+		} else if (arg == "--scales" && argi + 1 < argc) {
+			argi += 1;
+			scales.clear();
+			std::istringstream str(argv[argi]);
+			std::string scale;
+			while (std::getline(str, scale, ',')) {
+				scales.emplace_back(std::max(1U, uint32_t(std::stoul(scale))));
+			}
+		} else if (arg == "--filter" && argi + 1 < argc) {
+			argi += 1;
+			bench.filter = argv[argi];
+		} else if (arg == "--json" && argi + 1 < argc) {
+			argi += 1;
+			json_filename = argv[argi];
+		} else if (arg == "--content" && argi + 1 < argc) {
+			argi += 1;
+			scene_name = argv[argi];
+		} else if (arg == "--no-gl") {
+			use_gl = false;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--warmup W] [--reps R] [--scales 1,10,100,1000] [--filter <text>] [--json <file>] [--content <name>] [--no-gl]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "Benchmarks (" << bench.warmup << " warmup + " << bench.reps << " timed reps each):" << std::endl;
+
+	MeshData mesh_data = load_mesh_data(data_path(scene_name + ".pnct"));
+
+	for (uint32_t scale : scales) {
+		//mesh data, 'scale' times over:
+		std::string pnct_bytes;
+		std::vector< MeshBuffer::Vertex > vertices;
+		vertices.reserve(mesh_data.vertices.size() * scale);
+		for (uint32_t c = 0; c < scale; ++c) {
+			vertices.insert(vertices.end(), mesh_data.vertices.begin(), mesh_data.vertices.end());
+		}
+		{
+			std::ostringstream str;
+			write_chunk("pnct", vertices, &str);
+			pnct_bytes = str.str();
+		}
+
+		bench.run("read_chunk", scale, double(pnct_bytes.size()), "bytes", [&](){
+			std::istringstream from(pnct_bytes);
+			std::vector< MeshBuffer::Vertex > read;
+			read_chunk(from, "pnct", &read);
+			if (read.size() != vertices.size()) throw std::runtime_error("read_chunk read the wrong amount.");
+		});
+
+		bench.run("ChunkReader (64k-vertex blocks)", scale, double(pnct_bytes.size()), "bytes", [&](){
+			std::istringstream from(pnct_bytes);
+			ChunkReader< MeshBuffer::Vertex > reader(from, "pnct");
+			std::vector< MeshBuffer::Vertex > block;
+			size_t read = 0;
+			while (reader.read(&block)) read += block.size();
+			if (read != vertices.size()) throw std::runtime_error("ChunkReader read the wrong amount.");
+		});
+
+		//the same chunk, compressed (see read_write_chunk.hpp); throughput is in uncompressed bytes, for comparison with the above:
+		std::string compressed_bytes;
+		bench.run("write_chunk (compressed)", scale, double(pnct_bytes.size()), "bytes", [&](){
+			std::ostringstream str;
+			write_chunk("pnct", vertices, &str, ChunkCompressed);
+			compressed_bytes = str.str();
+		});
+		if (!compressed_bytes.empty()) {
+			std::cout << "    (" << pnct_bytes.size() << " bytes -> " << compressed_bytes.size() << " bytes compressed, "
+				<< 100.0 * double(compressed_bytes.size()) / double(pnct_bytes.size()) << "%)" << std::endl;
+		}
+		bench.run("read_chunk (compressed)", scale, double(pnct_bytes.size()), "bytes", [&](){
+			if (compressed_bytes.empty()) { //(in case writing was filtered out)
+				std::ostringstream str;
+				write_chunk("pnct", vertices, &str, ChunkCompressed);
+				compressed_bytes = str.str();
+			}
+		}, [&](){
+			std::istringstream from(compressed_bytes);
+			std::vector< MeshBuffer::Vertex > read;
+			read_chunk(from, "pnct", &read);
+			if (read.size() != vertices.size()) throw std::runtime_error("read_chunk read the wrong amount.");
+		});
+
+		Mesh all;
+		all.count = GLuint(vertices.size());
+		bench.run("MeshBuffer::compute_bounds", scale, double(vertices.size()), "vertices", [&](){
+			Mesh mesh = all;
+			MeshBuffer::compute_bounds(vertices, &mesh);
+			if (!(mesh.min.x <= mesh.max.x)) throw std::runtime_error("Bounds are empty.");
+		});
+		//(the box-only, one-vertex-at-a-time loop compute_bounds used to be, for comparison)
+		bench.run("bounds (serial scalar loop)", scale, double(vertices.size()), "vertices", [&](){
+			Mesh mesh = all;
+			for (uint32_t v = mesh.start; v < mesh.start + mesh.count; ++v) {
+				mesh.min = glm::min(mesh.min, vertices[v].Position);
+				mesh.max = glm::max(mesh.max, vertices[v].Position);
+			}
+			if (!(mesh.min.x <= mesh.max.x)) throw std::runtime_error("Bounds are empty.");
+		});
+		vertices = std::vector< MeshBuffer::Vertex >();
+
+		std::unique_ptr< Scene > scene;
+		bench.run("Scene::load (scaled build)", scale, 0.0, "", [&](){ scene.reset(new Scene()); }, [&](){
+			build_scaled_scene(scene.get(), mesh_data, scale);
+		});
+		if (!scene) {
+			scene.reset(new Scene());
+			build_scaled_scene(scene.get(), mesh_data, scale);
+		}
+
+		bench.run("transform hierarchy evaluation", scale, double(scene->transforms.size()), "transforms", [&](){
+			glm::vec3 sum = glm::vec3(0.0f);
+			for (Scene::Transform const &t : scene->transforms) {
+				sum += t.make_world_from_local()[3];
+			}
+			if (!std::isfinite(sum.x)) throw std::runtime_error("Transforms aren't finite.");
+		});
+
+		Scene copy;
+		bench.run("Scene::set", scale, double(scene->transforms.size()), "transforms", [&](){
+			copy.set(*scene);
+		});
+
+		//(there is no visibility culling yet, so this is the per-drawable work culling would add to)
+		Scene::Camera const &camera = *scene->cameras.begin();
+		Scene::DrawList list;
+		bench.run("Scene::record", scale, double(scene->drawables.size()), "drawables", [&](){
+			scene->record(camera, Scene::Drawable::PipelineTypeDefault, &list);
+		});
+	}
+
+	bench.run("load_png (wood.png)", 1, 0.0, "", [&](){
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > data;
+		load_png(data_path("textures/wood.png"), &size, &data, LowerLeftOrigin);
+	});
+
+	//------------ benchmarks using OpenGL ------------
+	SDL_GLContext context = nullptr;
+	//(decide what to run using the full result names, since the filter may be any part of them)
+	std::string const mesh_buffer_load_name = "MeshBuffer load (" + scene_name + ".pnct)";
+	std::string const render_cpu_name = "render (CPU)";
+	std::string const render_gpu_name = "render (GPU)";
+	bool want_render = bench.wanted(render_cpu_name) || bench.wanted(render_gpu_name);
+	if (use_gl && (bench.wanted(mesh_buffer_load_name) || want_render)) context = create_context();
+	if (context) {
+		bench.run(mesh_buffer_load_name, 1, double(mesh_data.bytes.size()), "bytes", [&](){
+			MeshBuffer buffer(data_path(scene_name + ".pnct"));
+			glDeleteBuffers(1, &buffer.buffer);
+		});
+
+		if (want_render) {
+			call_load_functions();
+			std::shared_ptr< ShadowMapMode > mode = std::make_shared< ShadowMapMode >();
+			for (uint32_t scale : scales) {
+				mode->set_scene_copies(scale);
+
+				Headless headless;
+				headless.frames = bench.warmup + bench.reps;
+				headless.run(*mode);
+
+				std::vector< double > cpu_ms(headless.cpu_ms.begin() + bench.warmup, headless.cpu_ms.end());
+				bench.add(render_cpu_name, scale, 0.0, "", bench.warmup, cpu_ms);
+				//(GPU times lag a few frames, so just drop as many as were warmup frames)
+				std::vector< double > gpu_ms(headless.gpu_ms.begin() + std::min< size_t >(bench.warmup, headless.gpu_ms.size()), headless.gpu_ms.end());
+				bench.add(render_gpu_name, scale, 0.0, "", bench.warmup, gpu_ms);
+			}
+			mode.reset();
+		}
+
+		frame_ring.clear();
+		profiler.clear();
+		SDL_GL_DestroyContext(context);
+		SDL_DestroyWindow(Mode::window);
+		Mode::window = NULL;
+	}
+
+	if (!json_filename.empty()) bench.write_json(json_filename);
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,440 @@
+//Converts Wavefront OBJ files to the .pnct + .scene formats scenes/export-meshes.py and export-scene.py write from Blender,
+// without needing Blender (and much faster for big meshes).
+//
+// Each object ('o') or group ('g') in the file becomes a mesh and a transform (at the origin) with a drawable using it.
+// Polygons are triangulated as fans; corners without normals get flat (face) normals; colors come from vertex colors
+//  ('v x y z r g b', as written by some tools) if present, otherwise from the material's diffuse color ('Kd' in the
+//  .mtl file), otherwise white (as in export-meshes.py).
+//
+// The file is parsed on one thread, then meshes are built in parallel (on the JobSystem) a batch at a time, and
+//  streamed to the .pnct with a ChunkWriter.
+//
+// Usage: convert-obj [--z-up] [--rig] [--compress] <in.obj> <out/base/name>  (writes <name>.pnct and <name>.scene)
+//  --z-up      the file is already z-up (by default, OBJ's usual y-up is converted to the z-up this code uses)
+//  --rig       also add the "Camera", "SpotParent", and "Spot" objects ShadowMapMode needs, framing the meshes
+//  --compress  compress the mesh data (see read_write_chunk.hpp)
+
+#include "Mesh.hpp"
+#include "JobSystem.hpp"
+#include "read_write_chunk.hpp"
+#include "file_entries.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//everything in an OBJ file, as parsed:
+struct ObjData {
+	std::vector< glm::vec3 > positions;
+	std::vector< glm::u8vec4 > position_colors; //(alpha is zero for positions without vertex colors; empty if none have them)
+	std::vector< glm::vec2 > texcoords;
+	std::vector< glm::vec3 > normals;
+
+	//polygon corners, as indices into the arrays above (-1U if not given):
+	struct Corner {
+		uint32_t position = -1U;
+		uint32_t texcoord = -1U;
+		uint32_t normal = -1U;
+	};
+	struct Object {
+		std::string name;
+		std::vector< Corner > corners;
+		std::vector< uint32_t > face_sizes; //corners in each face
+		std::vector< glm::u8vec4 > face_colors; //material color for each face
+	};
+	std::vector< Object > objects;
+};
+
+static std::string read_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "'.");
+	std::ostringstream data;
+	data << file.rdbuf();
+	return data.str();
+}
+
+//color bytes for a [0,1] color:
+static glm::u8vec4 to_color(glm::vec3 rgb) {
+	glm::vec3 c = glm::clamp(glm::round(rgb * 255.0f), glm::vec3(0.0f), glm::vec3(255.0f));
+	return glm::u8vec4(uint8_t(c.r), uint8_t(c.g), uint8_t(c.b), 0xff);
+}
+
+//'Kd' colors from an .mtl file:
+static void parse_mtl(std::string const &filename, std::unordered_map< std::string, glm::u8vec4 > *colors) {
+	std::istringstream file(read_file(filename));
+	std::string line, material;
+	while (std::getline(file, line)) {
+		std::istringstream str(line);
+		std::string cmd;
+		if (!(str >> cmd)) continue;
+		if (cmd == "newmtl") {
+			str >> std::ws;
+			std::getline(str, material);
+			(*colors)[material] = glm::u8vec4(0xff);
+		} else if (cmd == "Kd") {
+			glm::vec3 kd(1.0f);
+			str >> kd.r >> kd.g >> kd.b;
+			(*colors)[material] = to_color(kd);
+		}
+	}
+}
+
+static ObjData parse_obj(std::string const &filename, bool z_up) {
+	std::string data = read_file(filename);
+	std::string dir = filename.substr(0, filename.find_last_of("/\\") + 1);
+
+	ObjData obj;
+	std::unordered_map< std::string, glm::u8vec4 > material_colors;
+	glm::u8vec4 color = glm::u8vec4(0xff);
+
+	//(names are made unique after parsing, once it's known which objects have faces)
+	auto start_object = [&](std::string name) {
+		if (name.empty()) name = "Object";
+		if (!obj.objects.empty() && obj.objects.back().face_sizes.empty()) obj.objects.back().name = name; //(reuse empty objects)
+		else obj.objects.emplace_back().name = name;
+	};
+	//OBJ is usually y-up; this code uses z-up:
+	auto convert = [&](glm::vec3 v) {
+		return (z_up ? v : glm::vec3(v.x, -v.z, v.y));
+	};
+
+	char const *c = data.c_str();
+	char const *end = c + data.size();
+	uint32_t line_number = 0;
+	while (c < end) {
+		line_number += 1;
+		char const *eol = c;
+		while (eol < end && *eol != '\n') ++eol;
+
+		auto skip_space = [&]() { while (c < eol && (*c == ' ' || *c == '\t' || *c == '\r')) ++c; };
+		auto word = [&]() {
+			skip_space();
+			char const *b = c;
+			while (c < eol && *c != ' ' && *c != '\t' && *c != '\r') ++c;
+			return std::string_view(b, c - b);
+		};
+		auto rest = [&]() {
+			skip_space();
+			char const *e = eol;
+			while (e > c && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) --e;
+			return std::string(c, e);
+		};
+		auto number = [&]() {
+			char *after = nullptr;
+			float f = std::strtof(c, &after);
+			if (after == c || after > eol) throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": expected a number.");
+			c = after;
+			return f;
+		};
+		//does the line have more (non-space) text?
+		auto more = [&]() { skip_space(); return c < eol; };
+
+		std::string_view cmd = word();
+		if (cmd == "v") {
+			glm::vec3 p;
+			p.x = number(); p.y = number(); p.z = number();
+			obj.positions.emplace_back(convert(p));
+			if (more()) {
+				//vertex color extension -- 'v x y z r g b' -- (might also be a 'w' coordinate, if just one number follows):
+				glm::vec3 rgb;
+				rgb.r = number();
+				if (more()) {
+					rgb.g = number(); rgb.b = number();
+					obj.position_colors.resize(obj.positions.size(), glm::u8vec4(0));
+					obj.position_colors.back() = to_color(rgb);
+				}
+			}
+		} else if (cmd == "vt") {
+			glm::vec2 t;
+			t.x = number(); t.y = (more() ? number() : 0.0f);
+			obj.texcoords.emplace_back(t);
+		} else if (cmd == "vn") {
+			glm::vec3 n;
+			n.x = number(); n.y = number(); n.z = number();
+			obj.normals.emplace_back(convert(n));
+		} else if (cmd == "f") {
+			if (obj.objects.empty()) start_object("Object");
+			ObjData::Object &object = obj.objects.back();
+			uint32_t count = 0;
+			while (more()) {
+				//corner is 'p', 'p/t', 'p//n', or 'p/t/n'; negative indices count back from the latest element:
+				auto index = [&](size_t size) -> uint32_t {
+					char *after = nullptr;
+					long i = std::strtol(c, &after, 10);
+					if (after == c || after > eol) throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": expected an index.");
+					c = after;
+					long resolved = (i < 0 ? long(size) + i : i - 1);
+					if (i == 0 || resolved < 0 || resolved >= long(size)) throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": index out of range.");
+					return uint32_t(resolved);
+				};
+				ObjData::Corner corner;
+				corner.position = index(obj.positions.size());
+				if (c < eol && *c == '/') {
+					++c;
+					if (c < eol && *c != '/') corner.texcoord = index(obj.texcoords.size());
+					if (c < eol && *c == '/') {
+						++c;
+						corner.normal = index(obj.normals.size());
+					}
+				}
+				object.corners.emplace_back(corner);
+				count += 1;
+			}
+			if (count < 3) throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": face has fewer than three corners.");
+			object.face_sizes.emplace_back(count);
+			object.face_colors.emplace_back(color);
+		} else if (cmd == "o" || cmd == "g") {
+			start_object(rest());
+		} else if (cmd == "usemtl") {
+			std::string material = rest();
+			auto f = material_colors.find(material);
+			color = (f != material_colors.end() ? f->second : glm::u8vec4(0xff));
+		} else if (cmd == "mtllib") {
+			std::string mtl = rest();
+			try {
+				parse_mtl(dir + mtl, &material_colors);
+			} catch (std::exception const &e) {
+				std::cerr << "WARNING: " << e.what() << " (materials will be white)" << std::endl;
+			}
+		}
+		//(other commands -- 's', 'l', 'p', comments, ... -- are ignored)
+
+		c = eol + 1;
+	}
+
+	if (!obj.position_colors.empty()) obj.position_colors.resize(obj.positions.size(), glm::u8vec4(0));
+
+	//(objects without faces have no mesh)
+	obj.objects.erase(std::remove_if(obj.objects.begin(), obj.objects.end(), [](ObjData::Object const &o){ return o.face_sizes.empty(); }), obj.objects.end());
+
+	//make names unique: the first object with a name keeps it, and later ones get the first free "<name>.<n>"
+	// (names given in the file are all reserved first, so an explicit 'o A.1' keeps its name even if it comes after a second 'A')
+	std::unordered_set< std::string > taken;
+	for (auto const &object : obj.objects) taken.emplace(object.name);
+	std::unordered_set< std::string > kept;
+	std::unordered_map< std::string, uint32_t > suffixes; //(last suffix tried for each name)
+	for (auto &object : obj.objects) {
+		if (kept.emplace(object.name).second) continue;
+		uint32_t &suffix = suffixes[object.name];
+		std::string unique;
+		do {
+			suffix += 1;
+			unique = object.name + "." + std::to_string(suffix);
+		} while (!taken.emplace(unique).second);
+		object.name = unique;
+		kept.emplace(unique);
+	}
+
+	return obj;
+}
+
+//triangulated vertices for an object:
+// (runs as a job, so must not throw -- parse_obj has already checked indices)
+static void build_mesh(ObjData const &obj, ObjData::Object const &object, std::vector< MeshBuffer::Vertex > *vertices_) {
+	auto &vertices = *vertices_;
+	size_t triangles = 0;
+	for (uint32_t size : object.face_sizes) triangles += size - 2;
+	vertices.reserve(3 * triangles);
+
+	uint32_t first = 0;
+	for (uint32_t f = 0; f < object.face_sizes.size(); ++f) {
+		uint32_t size = object.face_sizes[f];
+		ObjData::Corner const *corners = &object.corners[first];
+		first += size;
+
+		for (uint32_t i = 1; i + 1 < size; ++i) {
+			ObjData::Corner const *tri[3] = { &corners[0], &corners[i], &corners[i+1] };
+			glm::vec3 p[3];
+			for (uint32_t k = 0; k < 3; ++k) p[k] = obj.positions[tri[k]->position];
+			glm::vec3 flat = glm::cross(p[1] - p[0], p[2] - p[0]);
+			float len = glm::length(flat);
+			flat = (len > 0.0f ? flat / len : glm::vec3(0.0f, 0.0f, 1.0f));
+
+			for (uint32_t k = 0; k < 3; ++k) {
+				MeshBuffer::Vertex &v = vertices.emplace_back();
+				v.Position = p[k];
+				v.Normal = (tri[k]->normal != -1U ? obj.normals[tri[k]->normal] : flat);
+				v.Color = object.face_colors[f];
+				if (!obj.position_colors.empty() && obj.position_colors[tri[k]->position].a != 0) v.Color = obj.position_colors[tri[k]->position];
+				v.TexCoord = (tri[k]->texcoord != -1U ? obj.texcoords[tri[k]->texcoord] : glm::vec2(0.0f));
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	bool z_up = false;
+	bool rig = false;
+	ChunkCompression compression = ChunkUncompressed;
+	std::vector< std::string > files;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--z-up") z_up = true;
+		else if (arg == "--rig") rig = true;
+		else if (arg == "--compress") compression = ChunkCompressed;
+		else if (arg.size() && arg[0] != '-') files.emplace_back(arg);
+		else {
+			files.clear();
+			break;
+		}
+	}
+	if (files.size() != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--z-up] [--rig] [--compress] <in.obj> <out/base/name>\n"
+			"Writes <out/base/name>.pnct and <out/base/name>.scene." << std::endl;
+		return 1;
+	}
+	std::string const &in = files[0];
+	std::string const &out = files[1];
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	ObjData obj = parse_obj(in, z_up);
+	if (obj.objects.empty()) throw std::runtime_error("No faces in '" + in + "'.");
+
+	auto parsed = std::chrono::high_resolution_clock::now();
+
+	//------------ meshes ------------
+	//built in parallel, a batch at a time, and streamed to the file (so only a batch of meshes is in memory at once):
+	Strings mesh_strings;
+	std::vector< IndexEntry > index;
+	glm::vec3 min = glm::vec3(std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	std::ofstream pnct(out + ".pnct", std::ios::binary);
+	if (!pnct) throw std::runtime_error("Failed to open '" + out + ".pnct' for writing.");
+	{
+		ChunkWriter< MeshBuffer::Vertex > writer("pnct", &pnct, compression);
+		uint32_t const batch = 4 * (JobSystem::shared().worker_count() + 1);
+		std::vector< std::vector< MeshBuffer::Vertex > > vertices(batch);
+		for (uint32_t first = 0; first < obj.objects.size(); first += batch) {
+			uint32_t count = std::min(batch, uint32_t(obj.objects.size()) - first);
+			JobSystem::shared().parallel_for(count, 1, [&](uint32_t begin, uint32_t end){
+				for (uint32_t i = begin; i < end; ++i) {
+					vertices[i].clear();
+					build_mesh(obj, obj.objects[first + i], &vertices[i]);
+				}
+			});
+			for (uint32_t i = 0; i < count; ++i) {
+				IndexEntry entry;
+				std::tie(entry.name_begin, entry.name_end) = mesh_strings.add(obj.objects[first + i].name);
+				entry.vertex_begin = uint32_t(writer.size());
+				writer.write(vertices[i]);
+				entry.vertex_end = uint32_t(writer.size());
+				index.emplace_back(entry);
+				for (auto const &v : vertices[i]) {
+					min = glm::min(min, v.Position);
+					max = glm::max(max, v.Position);
+				}
+			}
+		}
+		writer.close();
+	}
+	uint32_t vertex_count = index.back().vertex_end;
+
+	auto built = std::chrono::high_resolution_clock::now();
+
+	//------------ scene ------------
+	Strings strings;
+	std::vector< HierarchyEntry > hierarchy;
+	std::vector< MeshEntry > meshes;
+	std::vector< CameraEntry > cameras;
+	std::vector< LightEntry > lights;
+
+	auto add_transform = [&](std::string const &name, uint32_t parent, glm::vec3 position, glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f)) {
+		HierarchyEntry entry;
+		entry.parent = parent;
+		std::tie(entry.name_begin, entry.name_end) = strings.add(name);
+		entry.position = position;
+		entry.rotation = rotation;
+		entry.scale = glm::vec3(1.0f);
+		hierarchy.emplace_back(entry);
+		return uint32_t(hierarchy.size() - 1);
+	};
+
+	for (auto const &object : obj.objects) {
+		MeshEntry entry;
+		entry.transform = add_transform(object.name, -1U, glm::vec3(0.0f));
+		std::tie(entry.name_begin, entry.name_end) = strings.add(object.name);
+		meshes.emplace_back(entry);
+	}
+
+	if (rig) {
+		glm::vec3 center = 0.5f * (min + max);
+		float radius = std::max(0.5f * glm::length(max - min), 1e-3f);
+
+		//camera looking down at the meshes from one corner:
+		{
+			glm::vec3 position = center + radius * glm::vec3(1.5f, -1.5f, 1.2f);
+			CameraEntry camera;
+			camera.transform = add_transform("Camera", -1U, position, look_along(center - position));
+			std::copy_n("pers", 4, camera.type);
+			camera.data = 50.0f;
+			camera.clip_near = 0.01f * radius;
+			camera.clip_far = 100.0f * radius;
+			cameras.emplace_back(camera);
+		}
+
+		//spotlight above, covering the meshes (ShadowMapMode spins it around 'SpotParent'):
+		{
+			uint32_t parent = add_transform("SpotParent", -1U, glm::vec3(center.x, center.y, 0.0f));
+			glm::vec3 position = glm::vec3(0.5f * radius, 0.0f, center.z + 2.0f * radius);
+			LightEntry light;
+			light.transform = add_transform("Spot", parent, position, look_along(glm::vec3(0.0f, 0.0f, center.z) - position));
+			light.type = 's';
+			light.color = glm::u8vec3(0xff, 0xf0, 0xe0);
+			light.energy = 100.0f;
+			light.distance = 0.0f;
+			light.fov = glm::degrees(2.0f * std::atan2(1.2f * radius, glm::length(position - glm::vec3(0.0f, 0.0f, center.z))));
+			lights.emplace_back(light);
+		}
+	}
+
+	//------------ write files ------------
+	{
+		write_chunk("str0", mesh_strings.data, &pnct);
+		write_chunk("idx0", index, &pnct);
+		if (!pnct) throw std::runtime_error("Failed to write '" + out + ".pnct'.");
+	}
+	{
+		std::ofstream file(out + ".scene", std::ios::binary);
+		write_chunk("str0", strings.data, &file);
+		write_chunk("xfh0", hierarchy, &file);
+		write_chunk("msh0", meshes, &file);
+		write_chunk("cam0", cameras, &file);
+		write_chunk("lmp0", lights, &file);
+		if (!file) throw std::runtime_error("Failed to write '" + out + ".scene'.");
+	}
+
+	auto after = std::chrono::high_resolution_clock::now();
+	auto ms = [](auto a, auto b) { return std::chrono::duration< double >(b - a).count() * 1000.0; };
+
+	std::cout << "Wrote '" << out << ".pnct' (" << index.size() << " meshes, " << vertex_count / 3 << " triangles) and '" << out << ".scene'"
+		<< " in " << ms(before, after) << "ms (parse " << ms(before, parsed) << "ms, build + write meshes " << ms(parsed, built) << "ms, write scene " << ms(built, after) << "ms)." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
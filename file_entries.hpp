@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+ * On-disk layouts of the entries in .scene and .pnct files (as written by
+ *  scenes/export-scene.py and scenes/export-meshes.py), shared by the loaders
+ *  (Scene::load, MeshBuffer::MeshBuffer) and the tools that write or rewrite
+ *  these files (generate-scene, convert-obj, simplify-mesh, bench).
+ *
+ * Each is stored as an array in a chunk (see read_write_chunk.hpp):
+ *  .scene: 'str0' names, 'xfh0' HierarchyEntry, 'msh0' MeshEntry, 'cam0' CameraEntry, 'lmp0' LightEntry
+ *  .pnct:  'pnct' MeshBuffer::Vertex, 'str0' names, 'idx0' IndexEntry
+ * Names are [name_begin, name_end) ranges of the 'str0' chunk.
+ *
+ */
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct HierarchyEntry {
+	uint32_t parent; //(index of an earlier entry, or -1U for none)
+	uint32_t name_begin;
+	uint32_t name_end;
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+
+struct MeshEntry {
+	uint32_t transform;
+	uint32_t name_begin;
+	uint32_t name_end;
+};
+static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+struct CameraEntry {
+	uint32_t transform;
+	char type[4]; //"pers" or "orth"
+	float data; //fov in degrees for 'pers', scale for 'orth'
+	float clip_near, clip_far;
+};
+static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
+
+struct LightEntry {
+	uint32_t transform;
+	char type;
+	glm::u8vec3 color;
+	float energy;
+	float distance;
+	float fov;
+};
+static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+//-- helpers for writers --
+
+//strings for the 'str0' chunk:
+struct Strings {
+	std::vector< char > data;
+	std::pair< uint32_t, uint32_t > add(std::string const &str) {
+		uint32_t begin = uint32_t(data.size());
+		data.insert(data.end(), str.begin(), str.end());
+		return std::make_pair(begin, uint32_t(data.size()));
+	}
+};
+
+//rotation that points -z along 'forward' (with +y as close to world +z as possible), as for cameras and spotlights:
+inline glm::quat look_along(glm::vec3 forward) {
+	forward = glm::normalize(forward);
+	glm::vec3 world_up = (std::abs(forward.z) > 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::vec3 right = glm::normalize(glm::cross(forward, world_up));
+	glm::vec3 up = glm::cross(right, forward);
+	return glm::quat_cast(glm::mat3(right, up, -forward));
+}
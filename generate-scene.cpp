@@ -0,0 +1,309 @@
+//Procedural scene generator: writes a .scene + .pnct pair (the same formats scenes/export-*.py write from Blender)
+// with a configurable number of objects, hierarchy depth, mesh complexity, light count, and mesh sharing.
+//
+// Generated scenes have the objects ShadowMapMode looks for ("Camera", "SpotParent", and a "Spot" spotlight,
+//  plus a "Platform" and "Pedestal"), so can be shown with 'game --scene <name>' and benchmarked with
+//  'bench --content <name>'.
+//
+// Objects are bumpy spheres (each mesh gets its own bumps and color) arranged on a grid, with children
+//  clustered around their parents.
+//
+// Usage: generate-scene [options] <out/base/name>  (writes <name>.scene and <name>.pnct)
+//  --objects N      mesh objects to place (default 100)
+//  --depth D        levels in the transform hierarchy (default 3)
+//  --segments S     sphere segments around (triangles per mesh ~ S*S; default 16)
+//  --lights L       point lights, in addition to the spotlight (default 4)
+//  --instancing R   fraction of objects that reuse another object's mesh, in [0,1] (default 0.5)
+//  --seed X         random seed (default 1)
+//  --compress       compress the mesh data (see read_write_chunk.hpp)
+
+#include "Mesh.hpp"
+#include "read_write_chunk.hpp"
+#include "file_entries.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//add triangles to 'vertices', with flat normals:
+static void add_triangle(std::vector< MeshBuffer::Vertex > *vertices, glm::vec3 const (&p)[3], glm::vec2 const (&uv)[3], glm::u8vec4 color) {
+	glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+	float len = glm::length(n);
+	n = (len > 0.0f ? n / len : glm::vec3(0.0f, 0.0f, 1.0f));
+	for (uint32_t i = 0; i < 3; ++i) {
+		vertices->emplace_back(MeshBuffer::Vertex{ p[i], n, color, uv[i] });
+	}
+}
+
+//unit-ish sphere with random bumps:
+static void add_bumpy_sphere(std::vector< MeshBuffer::Vertex > *vertices, uint32_t segments, std::mt19937 &mt, glm::u8vec4 color) {
+	std::uniform_real_distribution< float > unit(0.0f, 1.0f);
+	float bumps = 2.0f + std::floor(4.0f * unit(mt));
+	float amount = 0.25f * unit(mt);
+	float phase = 6.2831853f * unit(mt);
+	uint32_t rings = std::max(2U, segments / 2);
+
+	auto at = [&](uint32_t s, uint32_t r) {
+		float theta = 6.2831853f * float(s) / float(segments);
+		float phi = 3.1415926f * float(r) / float(rings);
+		float radius = 1.0f + amount * std::sin(bumps * theta + phase) * std::sin(bumps * phi);
+		return radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta) * std::sin(phi), std::cos(phi));
+	};
+	auto uv = [&](uint32_t s, uint32_t r) {
+		return glm::vec2(float(s) / float(segments), 1.0f - float(r) / float(rings));
+	};
+
+	for (uint32_t r = 0; r < rings; ++r) {
+		for (uint32_t s = 0; s < segments; ++s) {
+			//(triangles at the poles would be degenerate, so skip them)
+			if (r != 0) add_triangle(vertices, { at(s,r), at(s+1,r+1), at(s+1,r) }, { uv(s,r), uv(s+1,r+1), uv(s+1,r) }, color);
+			if (r + 1 != rings) add_triangle(vertices, { at(s,r), at(s,r+1), at(s+1,r+1) }, { uv(s,r), uv(s,r+1), uv(s+1,r+1) }, color);
+		}
+	}
+}
+
+//axis-aligned box:
+static void add_box(std::vector< MeshBuffer::Vertex > *vertices, glm::vec3 min, glm::vec3 max, glm::u8vec4 color) {
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		for (uint32_t side = 0; side < 2; ++side) {
+			//corners of the face perpendicular to 'axis', on the min (side 0) or max (side 1) side:
+			uint32_t a = (axis + 1) % 3, b = (axis + 2) % 3;
+			if (side == 0) std::swap(a, b); //(keeps faces counter-clockwise from outside)
+			glm::vec3 c[4];
+			for (uint32_t i = 0; i < 4; ++i) {
+				c[i][axis] = (side ? max[axis] : min[axis]);
+				c[i][a] = ((i == 1 || i == 2) ? max[a] : min[a]);
+				c[i][b] = ((i >= 2) ? max[b] : min[b]);
+			}
+			glm::vec2 t[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+			glm::vec3 size = max - min;
+			for (auto &uv : t) uv *= glm::vec2(size[a], size[b]);
+			add_triangle(vertices, { c[0], c[1], c[2] }, { t[0], t[1], t[2] }, color);
+			add_triangle(vertices, { c[0], c[2], c[3] }, { t[0], t[2], t[3] }, color);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	uint32_t objects = 100;
+	uint32_t depth = 3;
+	uint32_t segments = 16;
+	uint32_t point_lights = 4;
+	float instancing = 0.5f;
+	uint32_t seed = 1;
+	ChunkCompression compression = ChunkUncompressed;
+	std::string out;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		auto number = [&]() -> std::string {
+			if (argi + 1 >= argc) throw std::runtime_error("Expected a value after '" + arg + "'.");
+			argi += 1;
+			return argv[argi];
+		};
+		if (arg == "--objects") objects = uint32_t(std::stoul(number()));
+		else if (arg == "--depth") depth = std::max(1U, uint32_t(std::stoul(number())));
+		else if (arg == "--segments") segments = std::max(3U, uint32_t(std::stoul(number())));
+		else if (arg == "--lights") point_lights = uint32_t(std::stoul(number()));
+		else if (arg == "--instancing") instancing = glm::clamp(std::stof(number()), 0.0f, 1.0f);
+		else if (arg == "--seed") seed = uint32_t(std::stoul(number()));
+		else if (arg == "--compress") compression = ChunkCompressed;
+		else if (out.empty() && arg.size() && arg[0] != '-') out = arg;
+		else {
+			out.clear();
+			break;
+		}
+	}
+	if (out.empty()) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--objects N] [--depth D] [--segments S] [--lights L] [--instancing R] [--seed X] [--compress] <out/base/name>\n"
+			"Writes <out/base/name>.scene and <out/base/name>.pnct." << std::endl;
+		return 1;
+	}
+
+	std::mt19937 mt(seed);
+	std::uniform_real_distribution< float > unit(0.0f, 1.0f);
+
+	//------------ meshes ------------
+	//(streamed to the file as they are made, so only one is in memory at a time)
+	std::ofstream pnct(out + ".pnct", std::ios::binary);
+	if (!pnct) throw std::runtime_error("Failed to open '" + out + ".pnct' for writing.");
+	ChunkWriter< MeshBuffer::Vertex > writer("pnct", &pnct, compression);
+	Strings mesh_strings;
+	std::vector< MeshBuffer::Vertex > vertices;
+	std::vector< IndexEntry > index;
+	auto add_mesh = [&](std::string const &name, auto const &make) {
+		IndexEntry entry;
+		std::tie(entry.name_begin, entry.name_end) = mesh_strings.add(name);
+		entry.vertex_begin = uint32_t(writer.size());
+		vertices.clear();
+		make();
+		writer.write(vertices);
+		entry.vertex_end = uint32_t(writer.size());
+		index.emplace_back(entry);
+	};
+
+	//everything stays within an 'extent' x 'extent' square, so it fits in the spotlight's shadow map:
+	float const extent = 20.0f;
+
+	add_mesh("Platform", [&](){
+		add_box(&vertices, glm::vec3(-0.6f * extent, -0.6f * extent, -0.5f), glm::vec3(0.6f * extent, 0.6f * extent, 0.0f), glm::u8vec4(0xff));
+	});
+	add_mesh("Pedestal", [&](){
+		add_box(&vertices, glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::u8vec4(0xff));
+	});
+
+	//objects reuse meshes at the 'instancing' rate:
+	uint32_t unique_meshes = std::max(1U, uint32_t(std::round(float(objects) * (1.0f - instancing))));
+	for (uint32_t m = 0; m < unique_meshes; ++m) {
+		glm::u8vec4 color(64 + mt() % 192, 64 + mt() % 192, 64 + mt() % 192, 0xff);
+		add_mesh("Sphere." + std::to_string(m), [&](){
+			add_bumpy_sphere(&vertices, segments, mt, color);
+		});
+	}
+	writer.close();
+	uint32_t vertex_count = uint32_t(writer.size());
+
+	//------------ scene ------------
+	Strings strings;
+	std::vector< HierarchyEntry > hierarchy;
+	std::vector< MeshEntry > meshes;
+	std::vector< CameraEntry > cameras;
+	std::vector< LightEntry > lights;
+
+	auto add_transform = [&](std::string const &name, uint32_t parent, glm::vec3 position, glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3 scale = glm::vec3(1.0f)) {
+		HierarchyEntry entry;
+		entry.parent = parent;
+		std::tie(entry.name_begin, entry.name_end) = strings.add(name);
+		entry.position = position;
+		entry.rotation = rotation;
+		entry.scale = scale;
+		hierarchy.emplace_back(entry);
+		return uint32_t(hierarchy.size() - 1);
+	};
+	auto add_drawable = [&](uint32_t transform, std::string const &mesh) {
+		MeshEntry entry;
+		entry.transform = transform;
+		std::tie(entry.name_begin, entry.name_end) = strings.add(mesh);
+		meshes.emplace_back(entry);
+	};
+
+	add_drawable(add_transform("Platform", -1U, glm::vec3(0.0f)), "Platform");
+	add_drawable(add_transform("Pedestal", -1U, glm::vec3(0.0f)), "Pedestal");
+
+	//objects are split evenly between hierarchy levels; each level's objects are children of the level above's:
+	uint32_t roots = std::max(1U, (objects + depth - 1) / depth);
+	uint32_t side = uint32_t(std::ceil(std::sqrt(float(roots))));
+	float spacing = extent / float(side);
+	std::vector< uint32_t > previous_level, level;
+	for (uint32_t i = 0; i < objects; ++i) {
+		uint32_t level_index = std::min(depth - 1, i / roots);
+		if (i != 0 && i % roots == 0 && level_index != 0) {
+			previous_level = std::move(level);
+			level.clear();
+		}
+		std::string mesh = "Sphere." + std::to_string(i < unique_meshes ? i : mt() % unique_meshes);
+		uint32_t transform;
+		if (level_index == 0) {
+			//roots on a grid, resting on the platform:
+			float size = 0.35f * spacing;
+			glm::vec3 position = glm::vec3(
+				(float(i % side) + 0.5f) * spacing - 0.5f * extent,
+				(float(i / side) + 0.5f) * spacing - 0.5f * extent,
+				size
+			);
+			transform = add_transform("Object." + std::to_string(i), -1U, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(size));
+		} else {
+			//children orbit a random parent (in its local space, so they scale with it):
+			uint32_t parent = previous_level[mt() % previous_level.size()];
+			float angle = 6.2831853f * unit(mt);
+			glm::vec3 position = glm::vec3(1.6f * std::cos(angle), 1.6f * std::sin(angle), 0.5f + unit(mt));
+			glm::quat rotation = glm::angleAxis(6.2831853f * unit(mt), glm::vec3(0.0f, 0.0f, 1.0f));
+			transform = add_transform("Object." + std::to_string(i), parent, position, rotation, glm::vec3(0.4f));
+		}
+		add_drawable(transform, mesh);
+		level.emplace_back(transform);
+	}
+
+	//camera looking down at the scene from one corner:
+	{
+		glm::vec3 position = glm::vec3(0.9f * extent, -0.9f * extent, 0.8f * extent);
+		uint32_t transform = add_transform("Camera", -1U, position, look_along(-position));
+		CameraEntry camera;
+		camera.transform = transform;
+		std::copy_n("pers", 4, camera.type);
+		camera.data = 50.0f;
+		camera.clip_near = 0.1f;
+		camera.clip_far = 1000.0f;
+		cameras.emplace_back(camera);
+	}
+
+	//spotlight (spun by ShadowMapMode around its parent), lighting the whole platform:
+	{
+		uint32_t parent = add_transform("SpotParent", -1U, glm::vec3(0.0f));
+		glm::vec3 position = glm::vec3(0.3f * extent, 0.0f, extent);
+		uint32_t transform = add_transform("Spot", parent, position, look_along(-position));
+		LightEntry light;
+		light.transform = transform;
+		light.type = 's';
+		light.color = glm::u8vec3(0xff, 0xf0, 0xe0);
+		light.energy = 100.0f;
+		light.distance = 0.0f;
+		light.fov = glm::degrees(2.0f * std::atan2(0.85f * extent, glm::length(position)));
+		lights.emplace_back(light);
+	}
+
+	for (uint32_t l = 0; l < point_lights; ++l) {
+		glm::vec3 position = glm::vec3((unit(mt) - 0.5f) * extent, (unit(mt) - 0.5f) * extent, 2.0f + 3.0f * unit(mt));
+		uint32_t transform = add_transform("Light." + std::to_string(l), -1U, position);
+		LightEntry light;
+		light.transform = transform;
+		light.type = 'p';
+		light.color = glm::u8vec3(128 + mt() % 128, 128 + mt() % 128, 128 + mt() % 128);
+		light.energy = 10.0f;
+		light.distance = 0.0f;
+		light.fov = 0.0f;
+		lights.emplace_back(light);
+	}
+
+	//------------ write files ------------
+	{
+		write_chunk("str0", mesh_strings.data, &pnct);
+		write_chunk("idx0", index, &pnct);
+		if (!pnct) throw std::runtime_error("Failed to write '" + out + ".pnct'.");
+	}
+	{
+		std::ofstream file(out + ".scene", std::ios::binary);
+		write_chunk("str0", strings.data, &file);
+		write_chunk("xfh0", hierarchy, &file);
+		write_chunk("msh0", meshes, &file);
+		write_chunk("cam0", cameras, &file);
+		write_chunk("lmp0", lights, &file);
+		if (!file) throw std::runtime_error("Failed to write '" + out + ".scene'.");
+	}
+
+	std::cout << "Wrote '" << out << ".scene' (" << hierarchy.size() << " transforms, " << meshes.size() << " drawables, " << lights.size() << " lights)"
+		<< " and '" << out << ".pnct' (" << index.size() << " meshes, " << vertex_count / 3 << " triangles)." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,24 @@
+#include "gl_extensions.hpp"
+
+#include <SDL3/SDL.h>
+#include <iostream>
+
+GLExtensions gl_ext;
+
+void init_GL_extensions() {
+	if (SDL_GL_ExtensionSupported("GL_ARB_clip_control")) {
+		gl_ext.ClipControl = (decltype(gl_ext.ClipControl))SDL_GL_GetProcAddress("glClipControl");
+		gl_ext.clip_control = (gl_ext.ClipControl != nullptr);
+	}
+	if (!gl_ext.clip_control) {
+		std::cout << "NOTE: GL_ARB_clip_control not available; reversed-Z depth will use [-1,1] clip space." << std::endl;
+	}
+
+	if (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+		gl_ext.BufferStorage = (decltype(gl_ext.BufferStorage))SDL_GL_GetProcAddress("glBufferStorage");
+		gl_ext.buffer_storage = (gl_ext.BufferStorage != nullptr);
+	}
+	if (!gl_ext.buffer_storage) {
+		std::cout << "NOTE: GL_ARB_buffer_storage not available; streamed GPU data will be copied in at the end of each batch instead of written in place." << std::endl;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * GL.hpp only exposes OpenGL 3.3 core.
+ * A few later features are worth using when the driver has them, so
+ *  init_GL_extensions() looks their entry points up at runtime.
+ *
+ * Check the flags in 'gl_ext' before calling any of its function pointers.
+ *
+ */
+
+#include "GL.hpp"
+
+//from GL_ARB_clip_control (core in OpenGL 4.5):
+#define GL_NEGATIVE_ONE_TO_ONE            0x935E
+#define GL_ZERO_TO_ONE                    0x935F
+
+//from GL_ARB_buffer_storage (core in OpenGL 4.4):
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_CLIENT_STORAGE_BIT             0x0200
+
+struct GLExtensions {
+	//GL_ARB_clip_control:
+	bool clip_control = false;
+	void (APIENTRY *ClipControl)(GLenum origin, GLenum depth) = nullptr;
+
+	//GL_ARB_buffer_storage:
+	bool buffer_storage = false;
+	void (APIENTRY *BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) = nullptr;
+};
+
+extern GLExtensions gl_ext;
+
+//look up extension entry points; call after init_GL():
+// (does not throw -- missing extensions just leave their flags false)
+void init_GL_extensions();
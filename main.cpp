@@ -9,10 +9,20 @@
 
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
+#include "gl_extensions.hpp"
+#include "GPURingBuffer.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
 
 //for screenshots:
 #include "load_save_png.hpp"
 
+//for (optionally) running updates with a fixed timestep:
+#include "FixedTimestep.hpp"
+
+//for (optionally) rendering offscreen benchmarks:
+#include "Headless.hpp"
+
 //Includes for libSDL:
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
@@ -23,6 +33,10 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <string>
+#include <vector>
+#include <future>
+#include <sstream>
 
 #ifdef _WIN32
 extern "C" { uint32_t GetACP(); }
@@ -43,10 +57,91 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line options ------------
+
+	//--fixed-timestep <hz> runs updates at a fixed rate (see FixedTimestep.hpp):
+	float fixed_timestep = 0.0f;
+	//--pipelined runs update (and recording) for the next frame on a separate thread while the current frame is drawn:
+	bool pipelined = false;
+	//--headless <frames> renders that many frames offscreen along a scripted camera path, reports timings, and exits (see Headless.hpp):
+	// --size <w>x<h> sets the resolution; --dump-frames <a,b,...> saves those frames as PNGs;
+	// --trace <file> saves a profile trace of the run; --stats <file> saves per-frame render stats as CSV
+	bool headless = false;
+	bool headless_options = false; //(any of the options that only apply with --headless were given)
+	Headless headless_run;
+	//--scene <name> shows dist/<name>.scene (with meshes from dist/<name>.pnct) instead of the vignette (sets scene_name, see ShadowMapMode.hpp)
+	auto usage = [&]() {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--fixed-timestep <hz>] [--pipelined] [--scene <name>] [--headless <frames> [--size <w>x<h>] [--dump-frames <a,b,...>] [--trace <file>] [--stats <file>]]" << std::endl;
+	};
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--fixed-timestep" && argi + 1 < argc) {
+			argi += 1;
+			float hz = std::stof(argv[argi]);
+			if (!(hz > 0.0f)) throw std::runtime_error("--fixed-timestep rate must be positive.");
+			fixed_timestep = 1.0f / hz;
+		} else if (arg == "--pipelined") {
+			pipelined = true;
+		} else if (arg == "--headless" && argi + 1 < argc) {
+			argi += 1;
+			int frames = std::stoi(argv[argi]);
+			if (frames <= 0) throw std::runtime_error("--headless frame count must be positive.");
+			headless = true;
+			headless_run.frames = uint32_t(frames);
+		} else if (arg == "--size" && argi + 1 < argc) {
+			argi += 1;
+			std::istringstream str(argv[argi]);
+			int w = 0, h = 0;
+			char x = '\0';
+			if (!(str >> w >> x >> h) || x != 'x' || w <= 0 || h <= 0) throw std::runtime_error("--size should look like 1280x720.");
+			headless_run.size = glm::uvec2(w, h);
+			headless_options = true;
+		} else if (arg == "--dump-frames" && argi + 1 < argc) {
+			argi += 1;
+			std::istringstream str(argv[argi]);
+			std::string frame;
+			while (std::getline(str, frame, ',')) {
+				headless_run.dump_frames.emplace_back(uint32_t(std::stoul(frame)));
+			}
+			headless_options = true;
+		} else if (arg == "--trace" && argi + 1 < argc) {
+			argi += 1;
+			headless_run.trace_filename = argv[argi];
+			headless_options = true;
+		} else if (arg == "--stats" && argi + 1 < argc) {
+			argi += 1;
+			headless_run.stats_filename = argv[argi];
+			headless_options = true;
+		} else if (arg == "--scene" && argi + 1 < argc) {
+			argi += 1;
+			scene_name = argv[argi];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	//(--size, --dump-frames, --trace, and --stats would be silently ignored in a windowed run)
+	if (headless_options && !headless) {
+		usage();
+		return 1;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
-	SDL_Init(SDL_INIT_VIDEO);
+	if (!SDL_Init(SDL_INIT_VIDEO)) {
+		if (!headless) {
+			std::cerr << "Error initializing SDL: " << SDL_GetError() << std::endl;
+			return 1;
+		}
+		//no display (e.g., on a build server)? SDL's offscreen driver can still make an OpenGL context (via EGL):
+		std::cerr << "NOTE: couldn't initialize video (" << SDL_GetError() << "); trying offscreen driver." << std::endl;
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+		if (!SDL_Init(SDL_INIT_VIDEO)) {
+			std::cerr << "Error initializing SDL: " << SDL_GetError() << std::endl;
+			return 1;
+		}
+	}
 
 	//Ask for an OpenGL context version 3.3, core profile, enable debug:
 	SDL_GL_ResetAttributes();
@@ -67,8 +162,9 @@ int main(int argc, char **argv) {
 		"shadow map demo",
 		1280, 720,
 		SDL_WINDOW_OPENGL
-		| SDL_WINDOW_RESIZABLE //uncomment to allow resizing
-		| SDL_WINDOW_HIGH_PIXEL_DENSITY //uncomment for full resolution on high-DPI screens
+		| (headless ? SDL_WINDOW_HIDDEN //(headless rendering only needs the window for its OpenGL context)
+		            : SDL_WINDOW_RESIZABLE //uncomment to allow resizing
+		            | SDL_WINDOW_HIGH_PIXEL_DENSITY) //uncomment for full resolution on high-DPI screens
 	);
 
 	//prevent exceedingly tiny windows when resizing:
@@ -91,8 +187,14 @@ int main(int argc, char **argv) {
 	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
 	init_GL();
 
+	//Look up entrypoints for optional (post-3.3) features:
+	init_GL_extensions();
+
 	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (!SDL_GL_SetSwapInterval(-1)) {
+	// (headless mode wants crazy FPS, and never swaps anyway)
+	if (headless) {
+		SDL_GL_SetSwapInterval(0);
+	} else if (!SDL_GL_SetSwapInterval(-1)) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
 		if (!SDL_GL_SetSwapInterval(1)) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
@@ -109,7 +211,16 @@ int main(int argc, char **argv) {
 	call_load_functions();
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< ShadowMapMode >());
+	std::shared_ptr< ShadowMapMode > shadow_map_mode = std::make_shared< ShadowMapMode >();
+	Mode::set_current(shadow_map_mode);
+	Mode::current->fixed_timestep = fixed_timestep;
+
+	//------------ headless benchmark (instead of main loop) ------------
+	if (headless) {
+		headless_run.run(*shadow_map_mode);
+		Mode::set_current(nullptr);
+	}
+	shadow_map_mode.reset();
 
 	//------------ main loop ------------
 
@@ -128,14 +239,70 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	//Mode::current's update + record step, for 'elapsed' seconds of real time:
+	// (in pipelined mode, this runs on the simulation thread)
+	Mode *recorded_mode = nullptr; //most recent mode to record a frame
+	auto update_and_record = [&](float elapsed, glm::uvec2 drawable_size) {
+		if (Mode::current->fixed_timestep > 0.0f) {
+			//run as many fixed-size steps as needed to catch up with real time (within a budget):
+			static FixedTimestep scheduler;
+			static Mode *scheduled_mode = nullptr;
+			if (scheduled_mode != Mode::current.get()) {
+				scheduled_mode = Mode::current.get();
+				scheduler.reset();
+			}
+			scheduler.step = Mode::current->fixed_timestep;
+
+			uint32_t dropped_frames = scheduler.dropped_frames;
+			uint32_t steps = scheduler.advance(elapsed);
+			if (scheduler.dropped_frames != dropped_frames) {
+				std::cerr << "NOTE: simulation fell behind; dropped " << scheduler.dropped * 1000.0 << "ms over " << scheduler.dropped_frames << " frames so far." << std::endl;
+			}
+
+			for (uint32_t step = 0; step < steps; ++step) {
+				Mode::current->update(Mode::current->fixed_timestep);
+				if (!Mode::current || Mode::current.get() != scheduled_mode) break;
+			}
+			if (!Mode::current) return;
+			Mode::current->draw_alpha = (Mode::current.get() == scheduled_mode ? scheduler.alpha() : 1.0f);
+		} else {
+			//if frames are taking a very long time to process,
+			//lag to avoid spiral of death:
+			elapsed = std::min(0.1f, elapsed);
+
+			Mode::current->update(elapsed);
+			if (!Mode::current) return;
+		}
+
+		Mode::current->record(drawable_size);
+		recorded_mode = Mode::current.get();
+	};
+
+	//in pipelined mode, the simulation thread's work for the next frame:
+	std::future< void > simulation;
+
 	//This will loop until the current mode is set to null:
-	while (Mode::current) {
+	// (checked below, only once any pipelined update is finished -- that update may call Mode::set_current,
+	//  so reading Mode::current here, while it might be running, would be a data race)
+	while (true) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
 		{ //(1) process any events that are pending
-			static SDL_Event evt;
+			//(gather events first, since a pipelined update might still be running)
+			static std::vector< SDL_Event > events;
+			events.clear();
+			SDL_Event evt;
 			while (SDL_PollEvent(&evt)) {
+				events.emplace_back(evt);
+			}
+
+			//wait for any pipelined update to finish before touching the mode:
+			// (also re-throws any exception from the simulation thread)
+			if (simulation.valid()) simulation.get();
+			if (!Mode::current) break;
+
+			for (SDL_Event const &evt : events) {
 				//handle resizing:
 				if (evt.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
 					on_resize();
@@ -165,32 +332,59 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
-			auto current_time = std::chrono::high_resolution_clock::now();
-			static auto previous_time = current_time;
-			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
-			previous_time = current_time;
+		//(2) call the current mode's "update" function to deal with elapsed time:
+		auto current_time = std::chrono::high_resolution_clock::now();
+		static auto previous_time = current_time;
+		float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
+		previous_time = current_time;
 
-			//if frames are taking a very long time to process,
-			//lag to avoid spiral of death:
-			elapsed = std::min(0.1f, elapsed);
+		if (pipelined && Mode::current->can_pipeline()) {
+			//(hold a reference, since the update might switch modes while this one is drawing)
+			std::shared_ptr< Mode > mode = Mode::current;
 
-			Mode::current->update(elapsed);
+			//nothing recorded yet (e.g., first frame in this mode)? record without updating:
+			if (recorded_mode != mode.get()) {
+				mode->record(drawable_size);
+				recorded_mode = mode.get();
+			}
+			mode->flip();
+
+			//update + record the next frame on the simulation thread...
+			simulation = std::async(std::launch::async, update_and_record, elapsed, drawable_size);
+
+			//...while (3) drawing the frame recorded last time:
+			mode->draw(drawable_size);
+			frame_ring.end_frame();
+			profiler.end_frame();
+			render_stats.end_frame();
+		} else {
+			update_and_record(elapsed, drawable_size);
 			if (!Mode::current) break;
-		}
 
-		{ //(3) call the current mode's "draw" function to produce output:
-		
+			//(3) call the current mode's "draw" function to produce output:
+			Mode::current->flip();
 			Mode::current->draw(drawable_size);
+			frame_ring.end_frame();
+			profiler.end_frame();
+			render_stats.end_frame();
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
 		SDL_GL_SwapWindow(Mode::window);
 	}
 
+	//(don't tear down while the simulation thread might still be using the mode)
+	if (simulation.valid()) simulation.get();
+
 
 	//------------  teardown ------------
 
+	if (frame_ring.stalls) {
+		std::cerr << "NOTE: frame_ring waited on the GPU " << frame_ring.stalls << " times; busiest frame used " << frame_ring.peak_frame_bytes << " of " << frame_ring.capacity << " bytes." << std::endl;
+	}
+	frame_ring.clear();
+	profiler.clear();
+
 	SDL_GL_DestroyContext(context);
 	context = 0;
 
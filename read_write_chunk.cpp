@@ -0,0 +1,235 @@
+#include "read_write_chunk.hpp"
+
+#include "JobSystem.hpp"
+
+#include <atomic>
+#include <cstring>
+
+//Compressed chunks are stored as independent blocks in the LZ4 block format
+// ( https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md ), so blocks can be
+// compressed and decompressed in parallel; the compressor is a simple greedy one with a
+// single-entry hash table (much like LZ4's "fast" mode), which does well on mesh data's
+// repeated normals, colors, and texture coordinates.
+
+namespace {
+	constexpr uint32_t MinMatch = 4;
+	constexpr uint32_t LastLiterals = 5; //the last five bytes of a block are always literals
+	constexpr uint32_t MatchLimit = 12; //...and the last match starts at least twelve bytes before the end
+	constexpr uint32_t MaxOffset = 65535;
+	constexpr uint32_t HashBits = 14;
+	constexpr uint32_t StoredFlag = 0x80000000; //(set in a block's size when it is stored uncompressed)
+
+	uint32_t read32(uint8_t const *p) {
+		uint32_t v;
+		std::memcpy(&v, p, 4);
+		return v;
+	}
+
+	//worst-case compressed size of 'size' bytes:
+	size_t compress_bound(size_t size) {
+		return size + size / 255 + 16;
+	}
+
+	//compress 'size' bytes from 'src' to 'dst' (which has room for compress_bound(size) bytes); returns compressed size:
+	size_t compress(uint8_t const *src, size_t size, uint8_t *dst) {
+		uint8_t *op = dst;
+
+		//write a sequence: literals [anchor, anchor + literals) followed by a match (unless match_length is zero, for the last sequence):
+		auto sequence = [&](uint8_t const *anchor, size_t literals, uint32_t offset, size_t match_length) {
+			uint8_t *token = op++;
+			*token = uint8_t(std::min< size_t >(literals, 15) << 4);
+			if (literals >= 15) {
+				size_t more = literals - 15;
+				for (; more >= 255; more -= 255) *op++ = 255;
+				*op++ = uint8_t(more);
+			}
+			std::memcpy(op, anchor, literals);
+			op += literals;
+			if (match_length == 0) return;
+
+			*op++ = uint8_t(offset & 0xff);
+			*op++ = uint8_t(offset >> 8);
+			size_t extra = match_length - MinMatch;
+			*token |= uint8_t(std::min< size_t >(extra, 15));
+			if (extra >= 15) {
+				size_t more = extra - 15;
+				for (; more >= 255; more -= 255) *op++ = 255;
+				*op++ = uint8_t(more);
+			}
+		};
+
+		uint8_t const *ip = src;
+		uint8_t const *anchor = src;
+		uint8_t const *end = src + size;
+		if (size > MatchLimit) {
+			std::vector< uint32_t > table(size_t(1) << HashBits, 0); //(position + 1 of the last place each hash was seen)
+			uint8_t const *match_limit = end - MatchLimit;
+			uint8_t const *match_end = end - LastLiterals;
+			uint32_t misses = 0; //(step through incompressible data faster)
+			while (ip < match_limit) {
+				uint32_t seq = read32(ip);
+				uint32_t &entry = table[(seq * 2654435761U) >> (32 - HashBits)];
+				uint8_t const *ref = (entry ? src + entry - 1 : nullptr);
+				bool found = (ref && size_t(ip - ref) <= MaxOffset && read32(ref) == seq);
+				entry = uint32_t(ip - src) + 1;
+				if (!found) {
+					ip += 1 + (misses++ >> 6);
+					continue;
+				}
+				misses = 0;
+
+				//extend the match forward (and backward, over literals not yet written):
+				uint8_t const *mp = ip + MinMatch;
+				uint8_t const *rp = ref + MinMatch;
+				while (mp < match_end && *mp == *rp) { ++mp; ++rp; }
+				while (ip > anchor && ref > src && ip[-1] == ref[-1]) { --ip; --ref; }
+
+				sequence(anchor, size_t(ip - anchor), uint32_t(ip - ref), size_t(mp - ip));
+				ip = mp;
+				anchor = ip;
+			}
+		}
+		sequence(anchor, size_t(end - anchor), 0, 0);
+		return size_t(op - dst);
+	}
+
+	//decompress 'size' bytes from 'src' into exactly 'out_size' bytes at 'dst'; returns false if the data is bad:
+	bool decompress(uint8_t const *src, size_t size, uint8_t *dst, size_t out_size) {
+		uint8_t const *ip = src;
+		uint8_t const *end = src + size;
+		uint8_t *op = dst;
+		uint8_t *out_end = dst + out_size;
+
+		while (true) {
+			if (ip >= end) return false;
+			uint8_t token = *ip++;
+
+			size_t literals = token >> 4;
+			if (literals == 15) {
+				uint8_t b;
+				do {
+					if (ip >= end) return false;
+					b = *ip++;
+					literals += b;
+				} while (b == 255);
+			}
+			if (literals > size_t(end - ip) || literals > size_t(out_end - op)) return false;
+			std::memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+
+			if (ip == end) break; //(the last sequence is only literals)
+
+			if (end - ip < 2) return false;
+			size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > size_t(op - dst)) return false;
+
+			size_t match_length = token & 0xf;
+			if (match_length == 15) {
+				uint8_t b;
+				do {
+					if (ip >= end) return false;
+					b = *ip++;
+					match_length += b;
+				} while (b == 255);
+			}
+			match_length += MinMatch;
+			if (match_length > size_t(out_end - op)) return false;
+
+			uint8_t const *ref = op - offset;
+			if (offset >= match_length) {
+				std::memcpy(op, ref, match_length);
+				op += match_length;
+			} else {
+				//(overlapping copies repeat the last 'offset' bytes, so must go a byte at a time)
+				for (size_t i = 0; i < match_length; ++i) *op++ = *ref++;
+			}
+		}
+		return op == out_end;
+	}
+}
+
+size_t chunk_compression::write_blocks(char const *data, size_t size, std::ostream &to) {
+	uint32_t blocks = uint32_t((size + BlockSize - 1) / BlockSize);
+
+	//compress blocks in parallel:
+	std::vector< std::vector< uint8_t > > compressed(blocks);
+	JobSystem::shared().parallel_for(blocks, 1, [&](uint32_t begin, uint32_t end){
+		for (uint32_t b = begin; b < end; ++b) {
+			size_t offset = size_t(b) * BlockSize;
+			size_t length = std::min< size_t >(BlockSize, size - offset);
+			compressed[b].resize(compress_bound(length));
+			compressed[b].resize(compress(reinterpret_cast< uint8_t const * >(data) + offset, length, compressed[b].data()));
+		}
+	});
+
+	//...and write them in order:
+	size_t written = 0;
+	for (uint32_t b = 0; b < blocks; ++b) {
+		size_t offset = size_t(b) * BlockSize;
+		size_t length = std::min< size_t >(BlockSize, size - offset);
+		uint32_t header;
+		if (compressed[b].size() < length) {
+			header = uint32_t(compressed[b].size());
+			to.write(reinterpret_cast< char const * >(&header), sizeof(header));
+			to.write(reinterpret_cast< char const * >(compressed[b].data()), compressed[b].size());
+		} else {
+			//(data that doesn't compress is stored as-is)
+			header = uint32_t(length) | StoredFlag;
+			to.write(reinterpret_cast< char const * >(&header), sizeof(header));
+			to.write(data + offset, length);
+		}
+		written += sizeof(header) + (header & ~StoredFlag);
+	}
+	return written;
+}
+
+size_t chunk_compression::read_blocks(std::istream &from, uint32_t block_size, size_t size, char *to) {
+	assert(block_size > 0);
+	uint32_t blocks = uint32_t((size + block_size - 1) / block_size);
+
+	//read the blocks (sequentially):
+	struct Block {
+		size_t begin = 0; //in 'data'
+		uint32_t size = 0;
+		bool stored = false;
+	};
+	std::vector< Block > infos(blocks);
+	std::vector< char > data;
+	data.reserve(size + blocks * sizeof(uint32_t)); //(blocks are never stored bigger than their uncompressed size)
+	for (uint32_t b = 0; b < blocks; ++b) {
+		uint32_t header;
+		if (!from.read(reinterpret_cast< char * >(&header), sizeof(header))) {
+			throw std::runtime_error("Failed to read compressed block header.");
+		}
+		Block &info = infos[b];
+		info.begin = data.size();
+		info.size = header & ~StoredFlag;
+		info.stored = (header & StoredFlag) != 0;
+		if (info.size > compress_bound(block_size)) throw std::runtime_error("Compressed block is too big.");
+		data.resize(data.size() + info.size);
+		if (!from.read(data.data() + info.begin, info.size)) {
+			throw std::runtime_error("Failed to read compressed block.");
+		}
+	}
+
+	//decompress them (in parallel):
+	std::atomic< bool > failed(false);
+	JobSystem::shared().parallel_for(blocks, 1, [&](uint32_t begin, uint32_t end){
+		for (uint32_t b = begin; b < end; ++b) {
+			size_t offset = size_t(b) * block_size;
+			size_t length = std::min< size_t >(block_size, size - offset);
+			Block const &info = infos[b];
+			if (info.stored) {
+				if (info.size != length) failed = true;
+				else std::memcpy(to + offset, data.data() + info.begin, length);
+			} else {
+				if (!decompress(reinterpret_cast< uint8_t const * >(data.data() + info.begin), info.size, reinterpret_cast< uint8_t * >(to + offset), length)) failed = true;
+			}
+		}
+	});
+	if (failed) throw std::runtime_error("Compressed chunk data is corrupt.");
+
+	return data.size() + blocks * sizeof(uint32_t);
+}
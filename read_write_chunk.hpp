@@ -4,50 +4,61 @@
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
 
 //helper function that reads an array of structures preceded by a simple header:
 //Expected format:
 // |ma|gi|c.|..| <-- four byte "magic number"
 // |sz|sz|sz|sz| <-- four byte (native endian) size
 // |TT...TT| * (sz/sizeof(TT)) <-- enough T structures to make up sz bytes
+//
+//Chunks may also be compressed (written with ChunkCompressed, below), in which case they are wrapped in an 'lzb0' chunk:
+// |l |z |b |0 | |sz|sz|sz|sz| <-- header; sz counts everything below
+// |ma|gi|c.|..| <-- the wrapped chunk's magic number
+// |rs|rs|rs|rs| <-- size of the wrapped chunk's (uncompressed) data
+// |bs|bs|bs|bs| <-- uncompressed bytes per block (all blocks but the last are this big)
+// { |cs|cs|cs|cs| |..cs bytes..| } * blocks <-- LZ4-format compressed blocks (if the high bit of cs is set, the block is stored as-is)
+//read_chunk and ChunkReader decompress these transparently (decoding a batch of blocks at a time in parallel, see read_write_chunk.cpp).
+
+enum ChunkCompression {
+	ChunkUncompressed,
+	ChunkCompressed,
+};
+
+template< typename T >
+struct ChunkReader;
+template< typename T >
+struct ChunkWriter;
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *to_) {
 	assert(to_);
 	auto &to = *to_;
 
-	struct ChunkHeader {
-		char magic[4] = {'\0', '\0', '\0', '\0'};
-		uint32_t size = 0;
-	};
-	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
-
-	ChunkHeader header;
-	if (!from.read(reinterpret_cast< char * >(&header), sizeof(header))) {
-		throw std::runtime_error("Failed to read chunk header");
-	}
-	if (std::string(header.magic,4) != magic) {
-		throw std::runtime_error("Unexpected magic number in chunk");
-	}
-
-	if (header.size % sizeof(T) != 0) {
-		throw std::runtime_error("Size of chunk not divisible by element size");
-	}
-
-	to.resize(header.size / sizeof(T));
-	if (!from.read(reinterpret_cast< char * >(&to[0]), to.size() * sizeof(T))) {
-		throw std::runtime_error("Failed to read chunk data.");
-	}
+	ChunkReader< T > reader(from, magic);
+	to.resize(reader.remaining);
+	reader.read(to.data(), to.size());
 }
 
 
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
-void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *to_) {
+void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *to_, ChunkCompression compression = ChunkUncompressed) {
 	assert(magic.size() == 4);
 	assert(to_);
 	auto &to = *to_;
 
+	if (compression == ChunkCompressed) {
+		ChunkWriter< T > writer(magic, &to, ChunkCompressed);
+		writer.write(from);
+		writer.close();
+		return;
+	}
+
 	struct ChunkHeader {
 		char magic[4] = {'\0', '\0', '\0', '\0'};
 		uint32_t size = 0;
@@ -63,3 +74,252 @@ void write_chunk(std::string const &magic, std::vector< T > const &from, std::os
 	to.write(reinterpret_cast< const char * >(&header), sizeof(header));
 	to.write(reinterpret_cast< const char * >(from.data()), from.size() * sizeof(T));
 }
+
+
+//compressed chunk internals (see read_write_chunk.cpp):
+namespace chunk_compression {
+	//header at the start of an 'lzb0' chunk's data:
+	struct Header {
+		char magic[4] = {'\0', '\0', '\0', '\0'}; //wrapped chunk's magic
+		uint32_t raw_size = 0;
+		uint32_t block_size = 0;
+	};
+	static_assert(sizeof(Header) == 12, "compressed chunk header is packed");
+
+	constexpr uint32_t BlockSize = 1 << 18; //(block size used when writing)
+	constexpr uint32_t BatchBlocks = 32; //blocks compressed or decompressed (in parallel) at once
+
+	//compress 'size' bytes of 'data' as (size + BlockSize - 1) / BlockSize blocks, and write them to 'to':
+	// returns the number of bytes written
+	size_t write_blocks(char const *data, size_t size, std::ostream &to);
+
+	//read (and decompress) enough blocks to make 'size' bytes:
+	// ('size' must be a multiple of 'block_size' unless it reaches the end of the chunk)
+	// returns the number of (compressed) bytes read
+	size_t read_blocks(std::istream &from, uint32_t block_size, size_t size, char *to);
+}
+
+//streaming versions of the above, for chunks too big to (comfortably) hold in memory all at once:
+//
+//Writing:
+// ChunkWriter< Vertex > writer("pnct", &file); //(writes a header with size zero)
+// writer.write(vertex); //one element...
+// writer.write(vertices); //...or many
+// writer.close(); //patches the header with the actual size (the stream must be seekable)
+//
+//Reading:
+// ChunkReader< Vertex > reader(file, "pnct"); //(reads and checks the header)
+// std::vector< Vertex > block;
+// while (reader.read(&block)) { ...do something with block... } //(block holds at most reader.block_size elements)
+//
+//Both also handle compressed chunks: pass ChunkCompressed when making the ChunkWriter; ChunkReader notices by itself.
+// (compressed data is handled BatchBlocks blocks at a time, so -- whether reading or writing a whole chunk or
+//  streaming it -- no more than one batch of compressed data is buffered)
+
+template< typename T >
+struct ChunkWriter {
+	ChunkWriter(std::string const &magic_, std::ostream *to_, ChunkCompression compression_ = ChunkUncompressed) : magic(magic_), to(to_), compression(compression_) {
+		assert(magic.size() == 4);
+		assert(to);
+		header = to->tellp();
+		if (compression == ChunkCompressed) {
+			write_chunk("lzb0", std::vector< char >(), to);
+			chunk_compression::Header compressed;
+			std::copy_n(magic.data(), 4, compressed.magic);
+			compressed.block_size = chunk_compression::BlockSize;
+			to->write(reinterpret_cast< char const * >(&compressed), sizeof(compressed));
+			stored = sizeof(compressed);
+		} else {
+			write_chunk(magic, std::vector< T >(), to);
+		}
+	}
+	//(a writer that isn't closed gets closed here, but -- since destructors can't throw -- errors are only reported by close())
+	~ChunkWriter() {
+		if (to) {
+			try { close(); } catch (std::exception const &e) { std::cerr << "WARNING: " << e.what() << std::endl; }
+		}
+	}
+	ChunkWriter(ChunkWriter const &) = delete;
+
+	void write(T const *data, size_t count) {
+		assert(to && "ChunkWriter is not closed");
+		char const *bytes_ = reinterpret_cast< char const * >(data);
+		if (compression == ChunkCompressed) {
+			//compress a batch of whole blocks at a time:
+			size_t const batch = size_t(chunk_compression::BatchBlocks) * chunk_compression::BlockSize;
+			size_t size = count * sizeof(T);
+			//...finishing any batch already started:
+			if (!pending.empty()) {
+				size_t take = std::min(size, batch - pending.size());
+				pending.insert(pending.end(), bytes_, bytes_ + take);
+				bytes_ += take;
+				size -= take;
+				if (pending.size() == batch) {
+					stored += chunk_compression::write_blocks(pending.data(), pending.size(), *to);
+					pending.clear();
+				}
+			}
+			//...then straight from 'data', keeping what's left over for later:
+			for (; size >= batch; bytes_ += batch, size -= batch) {
+				stored += chunk_compression::write_blocks(bytes_, batch, *to);
+			}
+			pending.insert(pending.end(), bytes_, bytes_ + size);
+		} else {
+			to->write(bytes_, count * sizeof(T));
+			stored += uint64_t(count) * sizeof(T);
+		}
+		bytes += uint64_t(count) * sizeof(T);
+	}
+	void write(T const &element) { write(&element, 1); }
+	void write(std::vector< T > const &elements) { write(elements.data(), elements.size()); }
+
+	//elements written so far:
+	size_t size() const { return size_t(bytes / sizeof(T)); }
+
+	void close() {
+		assert(to && "ChunkWriter is only closed once");
+		std::ostream &out = *to;
+		to = nullptr;
+		if (compression == ChunkCompressed && !pending.empty()) {
+			stored += chunk_compression::write_blocks(pending.data(), pending.size(), out);
+			pending.clear();
+		}
+		if (bytes > 0xffffffffULL || stored > 0xffffffffULL) {
+			throw std::runtime_error("Chunk '" + magic + "' is too big (" + std::to_string(bytes) + " bytes) for its 32-bit size.");
+		}
+		uint32_t size = uint32_t(stored);
+		std::streampos end = out.tellp();
+		out.seekp(header + std::streamoff(4)); //(size follows the four-byte magic number)
+		out.write(reinterpret_cast< char const * >(&size), sizeof(size));
+		if (compression == ChunkCompressed) {
+			uint32_t raw_size = uint32_t(bytes);
+			out.seekp(header + std::streamoff(8 + offsetof(chunk_compression::Header, raw_size)));
+			out.write(reinterpret_cast< char const * >(&raw_size), sizeof(raw_size));
+		}
+		out.seekp(end);
+		if (!out) throw std::runtime_error("Failed to write chunk '" + magic + "'.");
+	}
+
+	std::string magic;
+	std::ostream *to; //(nullptr once closed)
+	ChunkCompression compression;
+	std::streampos header; //where the chunk starts
+	uint64_t bytes = 0; //data written so far
+	uint64_t stored = 0; //bytes after the header so far (differs from 'bytes' when compressing)
+	std::vector< char > pending; //data not yet compressed
+};
+
+template< typename T >
+struct ChunkReader {
+	ChunkReader(std::istream &from_, std::string const &magic, size_t block_size_ = (1 << 16)) : from(from_), block_size(block_size_) {
+		struct ChunkHeader {
+			char magic[4] = {'\0', '\0', '\0', '\0'};
+			uint32_t size = 0;
+		};
+		static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+		ChunkHeader header;
+		if (!from.read(reinterpret_cast< char * >(&header), sizeof(header))) {
+			throw std::runtime_error("Failed to read chunk header");
+		}
+		uint32_t size = header.size;
+		if (std::string(header.magic,4) == "lzb0") {
+			chunk_compression::Header compressed;
+			if (header.size < sizeof(compressed) || !from.read(reinterpret_cast< char * >(&compressed), sizeof(compressed))) {
+				throw std::runtime_error("Failed to read compressed chunk header");
+			}
+			if (std::string(compressed.magic,4) != magic) {
+				throw std::runtime_error("Unexpected magic number in chunk");
+			}
+			if (compressed.block_size == 0) {
+				throw std::runtime_error("Compressed chunk has zero-size blocks");
+			}
+			size = compressed.raw_size;
+			compressed_block_size = compressed.block_size;
+			compressed_left = header.size - sizeof(compressed);
+			undecoded = size;
+		} else if (std::string(header.magic,4) != magic) {
+			throw std::runtime_error("Unexpected magic number in chunk");
+		}
+
+		if (size % sizeof(T) != 0) {
+			throw std::runtime_error("Size of chunk not divisible by element size");
+		}
+		remaining = size / sizeof(T);
+	}
+
+	//read the next 'count' elements (no more than 'remaining') into 'to':
+	void read(T *to, size_t count) {
+		assert(count <= remaining);
+		if (compressed_block_size) {
+			read_compressed(reinterpret_cast< char * >(to), count * sizeof(T));
+		} else if (count && !from.read(reinterpret_cast< char * >(to), count * sizeof(T))) {
+			throw std::runtime_error("Failed to read chunk data.");
+		}
+		remaining -= count;
+	}
+
+	//read the next block of (at most) 'block_size' elements into 'block'; returns false (with an empty block) at the end of the chunk:
+	bool read(std::vector< T > *block_) {
+		assert(block_);
+		auto &block = *block_;
+		block.resize(std::min(block_size, remaining));
+		read(block.data(), block.size());
+		return !block.empty();
+	}
+
+	std::istream &from;
+	size_t block_size; //elements per block
+	size_t remaining = 0; //elements not yet read
+
+	//for compressed chunks:
+	uint32_t compressed_block_size = 0; //(zero if the chunk isn't compressed)
+	size_t compressed_left = 0; //compressed bytes not yet read from 'from'
+	size_t undecoded = 0; //uncompressed bytes not yet decompressed
+	std::vector< char > decoded; //decompressed bytes not yet read
+	size_t decoded_offset = 0;
+
+	void read_compressed(char *to, size_t size) {
+		//first, anything already decompressed:
+		size_t take = std::min(size, decoded.size() - decoded_offset);
+		if (take) std::memcpy(to, decoded.data() + decoded_offset, take);
+		decoded_offset += take;
+		to += take;
+		size -= take;
+
+		//then whole blocks straight into 'to':
+		size_t direct = (size == undecoded ? size : size - size % compressed_block_size);
+		if (direct) {
+			decode(to, direct);
+			to += direct;
+			size -= direct;
+		}
+
+		//finally, the start of the next batch of blocks:
+		if (size) {
+			assert(decoded_offset == decoded.size());
+			decoded.resize(std::min(undecoded, size_t(chunk_compression::BatchBlocks) * compressed_block_size));
+			decode(decoded.data(), decoded.size());
+			decoded_offset = 0;
+			assert(size <= decoded.size());
+			std::memcpy(to, decoded.data(), size);
+			decoded_offset = size;
+		}
+	}
+	//decompress the next 'size' bytes into 'to', BatchBlocks blocks at a time:
+	// (so only one batch of compressed data is buffered, however big 'size' is)
+	void decode(char *to, size_t size) {
+		assert(size <= undecoded);
+		size_t const batch = size_t(chunk_compression::BatchBlocks) * compressed_block_size;
+		while (size) {
+			size_t step = std::min(size, batch);
+			size_t read = chunk_compression::read_blocks(from, compressed_block_size, step, to);
+			if (read > compressed_left) throw std::runtime_error("Compressed chunk data overruns chunk.");
+			compressed_left -= read;
+			undecoded -= step;
+			to += step;
+			size -= step;
+		}
+		if (undecoded == 0 && compressed_left != 0) throw std::runtime_error("Compressed chunk has extra data.");
+	}
+};
@@ -0,0 +1,268 @@
+//Adds coarser levels of detail to the meshes in a .pnct file, made by vertex clustering
+// (as in Rossignac and Borrel, "Multi-Resolution 3D Approximations for Rendering Complex Scenes", 1993):
+//
+// Each mesh's bounding box is divided into a grid of cells; every corner in a cell moves to the average position
+//  of the cell's corners, and triangles left with two corners in the same cell are dropped. Normals, colors, and
+//  texture coordinates are averaged per cell too -- separately for corners whose normals point along different
+//  axes, so creases (like a box's edges) stay sharp.
+// Each level halves the grid resolution of the one before. Levels that don't remove at least a quarter of the
+//  previous level's triangles aren't kept, so small meshes get fewer levels (or none).
+//
+// Levels are written as meshes named "<name>@lod1", "<name>@lod2", ... after the original meshes, and MeshBuffer
+//  attaches them to "<name>" when loading (see Mesh.hpp); "@lod" meshes already in the input are replaced.
+// Meshes are simplified in parallel (on the JobSystem).
+//
+// Usage: simplify-mesh [--levels <n>] [--grid <cells>] [--compress] <in.pnct> [out.pnct]  (out defaults to in)
+//  --levels    most levels to make for each mesh (default 3, the most MeshBuffer keeps)
+//  --grid      cells along the longest side of a mesh's bounding box, for the first level (default 32)
+//  --compress  compress the mesh data (see read_write_chunk.hpp)
+
+#include "Mesh.hpp"
+#include "JobSystem.hpp"
+#include "read_write_chunk.hpp"
+#include "file_entries.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//is 'name' a level-of-detail mesh name ("<name>@lod<digits>")?
+static bool is_lod_name(std::string const &name) {
+	size_t at = name.rfind("@lod");
+	if (at == std::string::npos || at + 4 == name.size()) return false;
+	for (size_t i = at + 4; i < name.size(); ++i) {
+		if (name[i] < '0' || name[i] > '9') return false;
+	}
+	return true;
+}
+
+//simplify triangles [begin, end) by clustering their corners in a grid with 'grid' cells along the bounding box's longest side:
+// (appends triangles to 'out'; runs on JobSystem workers, so must not throw)
+static void simplify(MeshBuffer::Vertex const *begin, MeshBuffer::Vertex const *end, uint32_t grid, std::vector< MeshBuffer::Vertex > *out) {
+	assert(out);
+	uint32_t corners = uint32_t(end - begin) / 3 * 3;
+	if (corners == 0) return;
+
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (uint32_t i = 0; i < corners; ++i) {
+		min = glm::min(min, begin[i].Position);
+		max = glm::max(max, begin[i].Position);
+	}
+	float longest = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+	if (!(longest > 0.0f && std::isfinite(longest))) return; //(nothing sensible to do with flat or broken meshes)
+	float cells_per_unit = float(grid) / longest;
+
+	//cells (positions are averaged per cell):
+	struct Cell {
+		glm::vec3 position = glm::vec3(0.0f);
+		uint32_t count = 0;
+	};
+	std::vector< Cell > cells;
+	std::unordered_map< uint64_t, uint32_t > cell_index;
+
+	//attributes are averaged per (cell, major axis of normal):
+	struct Attributes {
+		glm::vec3 normal = glm::vec3(0.0f);
+		glm::vec4 color = glm::vec4(0.0f);
+		glm::vec2 tex_coord = glm::vec2(0.0f);
+		uint32_t count = 0;
+	};
+	std::vector< Attributes > attributes;
+	std::unordered_map< uint64_t, uint32_t > attribute_index;
+
+	std::vector< uint32_t > corner_cell(corners);
+	std::vector< uint32_t > corner_attributes(corners);
+	for (uint32_t i = 0; i < corners; ++i) {
+		MeshBuffer::Vertex const &v = begin[i];
+
+		glm::uvec3 c = glm::uvec3(glm::clamp((v.Position - min) * cells_per_unit, glm::vec3(0.0f), glm::vec3(float(grid - 1))));
+		uint64_t key = uint64_t(c.x) | (uint64_t(c.y) << 21) | (uint64_t(c.z) << 42);
+		auto f = cell_index.emplace(key, uint32_t(cells.size())).first;
+		if (f->second == cells.size()) cells.emplace_back();
+		Cell &cell = cells[f->second];
+		cell.position += v.Position;
+		cell.count += 1;
+		corner_cell[i] = f->second;
+
+		glm::vec3 n = glm::abs(v.Normal);
+		uint32_t axis = (n.x >= n.y && n.x >= n.z ? 0 : (n.y >= n.z ? 1 : 2));
+		uint32_t side = axis * 2 + (v.Normal[axis] < 0.0f ? 1 : 0);
+		uint64_t attribute_key = uint64_t(f->second) * 6 + side;
+		auto a = attribute_index.emplace(attribute_key, uint32_t(attributes.size())).first;
+		if (a->second == attributes.size()) attributes.emplace_back();
+		Attributes &attribute = attributes[a->second];
+		attribute.normal += v.Normal;
+		attribute.color += glm::vec4(v.Color);
+		attribute.tex_coord += v.TexCoord;
+		attribute.count += 1;
+		corner_attributes[i] = a->second;
+	}
+
+	//keep triangles whose corners are still in different cells:
+	for (uint32_t i = 0; i < corners; i += 3) {
+		uint32_t a = corner_cell[i], b = corner_cell[i+1], c = corner_cell[i+2];
+		if (a == b || b == c || c == a) continue;
+		for (uint32_t j = i; j < i + 3; ++j) {
+			Cell const &cell = cells[corner_cell[j]];
+			Attributes const &attribute = attributes[corner_attributes[j]];
+			MeshBuffer::Vertex v;
+			v.Position = cell.position / float(cell.count);
+			float length = glm::length(attribute.normal);
+			v.Normal = (length > 1e-6f ? attribute.normal / length : begin[j].Normal);
+			glm::vec4 color = attribute.color / float(attribute.count) + 0.5f;
+			v.Color = glm::u8vec4(glm::clamp(color, glm::vec4(0.0f), glm::vec4(255.0f)));
+			v.TexCoord = attribute.tex_coord / float(attribute.count);
+			out->emplace_back(v);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try {
+#endif
+	uint32_t max_levels = Mesh::MaxLODs;
+	uint32_t grid = 32;
+	ChunkCompression compression = ChunkUncompressed;
+	std::vector< std::string > files;
+	bool usage = false;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--levels" && argi + 1 < argc) max_levels = uint32_t(std::max(1, std::atoi(argv[++argi])));
+		else if (arg == "--grid" && argi + 1 < argc) grid = uint32_t(std::clamp(std::atoi(argv[++argi]), 2, 1 << 20));
+		else if (arg == "--compress") compression = ChunkCompressed;
+		else if (arg.size() && arg[0] != '-') files.emplace_back(arg);
+		else usage = true;
+	}
+	if (usage || files.empty() || files.size() > 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--levels <n>] [--grid <cells>] [--compress] <in.pnct> [out.pnct]\n"
+			"Adds levels of detail (meshes named '<name>@lod<n>') to the meshes in <in.pnct>, writing the result to <out.pnct> (by default, back to <in.pnct>)." << std::endl;
+		return 1;
+	}
+	if (max_levels > Mesh::MaxLODs) {
+		std::cerr << "NOTE: MeshBuffer only uses the first " << Mesh::MaxLODs << " levels of detail." << std::endl;
+	}
+	std::string const &in = files[0];
+	std::string const &out = (files.size() == 2 ? files[1] : files[0]);
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	//------------ read ------------
+	std::vector< MeshBuffer::Vertex > data;
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	{
+		std::ifstream file(in, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open '" + in + "'.");
+		read_chunk(file, "pnct", &data);
+		read_chunk(file, "str0", &strings);
+		read_chunk(file, "idx0", &index);
+	}
+
+	//meshes to simplify (existing levels of detail are dropped):
+	struct Source {
+		std::string name;
+		uint32_t begin, end;
+		std::vector< std::vector< MeshBuffer::Vertex > > levels;
+	};
+	std::vector< Source > sources;
+	for (auto const &entry : index) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= data.size())) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		std::string name(strings.data() + entry.name_begin, strings.data() + entry.name_end);
+		if (is_lod_name(name)) continue;
+		sources.emplace_back(Source{ name, entry.vertex_begin, entry.vertex_end, {} });
+	}
+
+	auto read = std::chrono::high_resolution_clock::now();
+
+	//------------ simplify ------------
+	JobSystem::shared().parallel_for(uint32_t(sources.size()), 1, [&](uint32_t begin, uint32_t end){
+		std::vector< MeshBuffer::Vertex > level;
+		for (uint32_t s = begin; s < end; ++s) {
+			Source &source = sources[s];
+			uint32_t previous = (source.end - source.begin) / 3; //(triangles in the last level kept)
+			for (uint32_t cells = grid; cells >= 2 && source.levels.size() < max_levels; cells /= 2) {
+				level.clear();
+				simplify(data.data() + source.begin, data.data() + source.end, cells, &level);
+				uint32_t triangles = uint32_t(level.size() / 3);
+				if (triangles == 0) break;
+				if (4 * triangles > 3 * previous) continue; //(not enough of a reduction to be worth a level)
+				source.levels.emplace_back(level);
+				previous = triangles;
+			}
+		}
+	});
+
+	auto simplified = std::chrono::high_resolution_clock::now();
+
+	//------------ write ------------
+	Strings mesh_strings;
+	std::vector< IndexEntry > out_index;
+	std::vector< uint64_t > level_triangles(max_levels + 1, 0);
+	std::ofstream pnct(out, std::ios::binary);
+	if (!pnct) throw std::runtime_error("Failed to open '" + out + "' for writing.");
+	{
+		ChunkWriter< MeshBuffer::Vertex > writer("pnct", &pnct, compression);
+		auto add = [&](std::string const &name, MeshBuffer::Vertex const *vertices, size_t count) {
+			IndexEntry entry;
+			std::tie(entry.name_begin, entry.name_end) = mesh_strings.add(name);
+			entry.vertex_begin = uint32_t(writer.size());
+			writer.write(vertices, count);
+			entry.vertex_end = uint32_t(writer.size());
+			out_index.emplace_back(entry);
+		};
+		for (auto const &source : sources) {
+			add(source.name, data.data() + source.begin, source.end - source.begin);
+			level_triangles[0] += (source.end - source.begin) / 3;
+		}
+		for (auto const &source : sources) {
+			for (uint32_t l = 0; l < source.levels.size(); ++l) {
+				add(source.name + "@lod" + std::to_string(l + 1), source.levels[l].data(), source.levels[l].size());
+				level_triangles[l + 1] += source.levels[l].size() / 3;
+			}
+		}
+		writer.close();
+	}
+	write_chunk("str0", mesh_strings.data, &pnct);
+	write_chunk("idx0", out_index, &pnct);
+	if (!pnct) throw std::runtime_error("Failed to write '" + out + "'.");
+	pnct.close();
+
+	auto after = std::chrono::high_resolution_clock::now();
+	auto ms = [](auto a, auto b) { return std::chrono::duration< double >(b - a).count() * 1000.0; };
+
+	std::cout << "Wrote '" << out << "' (" << sources.size() << " meshes; triangles in meshes and each level of detail:";
+	for (uint32_t l = 0; l < level_triangles.size(); ++l) {
+		std::cout << (l ? ", " : " ") << level_triangles[l];
+	}
+	std::cout << ") in " << ms(before, after) << "ms (read " << ms(before, read) << "ms, simplify " << ms(read, simplified) << "ms, write " << ms(simplified, after) << "ms)." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}